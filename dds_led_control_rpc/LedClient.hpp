@@ -0,0 +1,857 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <map>
+#include <array>
+#include <vector>
+#include <functional>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <memory>
+
+#include "LedControl.hpp"
+#include "LedLog.hpp"
+#include "LedQos.hpp"
+#include "LedReadiness.hpp"
+#include "LedTrace.hpp"
+#include "LedProbes.hpp"
+#include "LedStartup.hpp"
+#include "RateController.hpp"
+
+/* Include the C++ DDS API. */
+#include "dds/dds.hpp"
+
+
+class LedClient
+{
+public:
+    // Synchronous in-memory path to a server living in the same process.
+    // When set, requests bypass DDS (and its serialization) entirely.
+    using DirectHandler = std::function<led_control::LedResponse(const led_control::LedRequest&)>;
+
+    // Called once per submitted request, with its response - or, under cumulative
+    // acks or on timeout, a response made up locally (see submit()).
+    using Completion = std::function<void(const led_control::LedResponse&)>;
+
+private:
+    dds::domain::DomainParticipant participant;
+    dds::topic::Topic<led_control::LedRequest> request_topic;
+    dds::topic::Topic<led_control::LedResponse> response_topic;
+    dds::pub::Publisher publisher;
+    dds::sub::Subscriber subscriber;
+    dds::pub::Publisher request_publisher;     // in the primary replica's partition, if any
+    dds::pub::Publisher bulk_publisher;
+    dds::sub::Subscriber bulk_subscriber;
+    dds::pub::DataWriter<led_control::LedRequest> request_writer;
+    dds::sub::DataReader<led_control::LedResponse> response_reader;
+    dds::topic::Topic<led_control::LedAck> ack_topic;
+    dds::sub::DataReader<led_control::LedAck> ack_reader;
+    dds::topic::Topic<led_control::LedSetpoint> setpoint_topic;
+    dds::pub::DataWriter<led_control::LedSetpoint> setpoint_writer;
+    dds::topic::Topic<led_control::LedCancel> cancel_topic;
+    dds::pub::DataWriter<led_control::LedCancel> cancel_writer;
+    dds::topic::Topic<led_control::LedLoadReport> load_topic;
+    dds::sub::DataReader<led_control::LedLoadReport> load_reader;
+    std::vector<dds::pub::DataWriter<led_control::LedRequest>> hedge_writers;   // alternate replicas
+
+    std::atomic<bool> running{true};
+    bool verbose{true};
+    std::chrono::microseconds request_interval{0};   // 0 == no random traffic
+    std::chrono::microseconds setpoint_interval{0};  // 0 == no setpoint stream
+    unsigned long setpoint_counter{0};
+    std::chrono::steady_clock::time_point next_request{std::chrono::steady_clock::now()};
+    std::chrono::steady_clock::time_point next_setpoint{next_request};
+    std::unique_ptr<RateController> rate_controller;   // set == adapt the request rate to server load
+    std::string primary_replica;                       // whose load reports we follow
+    unsigned long timeouts_at_last_report{0};
+    uint32_t client_id{0};   // random, to tell our responses/acks apart from other clients'
+    uint32_t panel_id{0};    // the server-side panel all our requests and setpoints address
+    unsigned long request_counter{0};
+
+    struct PendingRequest
+    {
+        std::chrono::steady_clock::time_point sent;
+        bool hedgeable = false;           // idempotent, and there is a replica to hedge to
+        bool hedged = false;
+        led_control::LedRequest request;  // only kept when hedgeable
+        Completion done;
+    };
+
+    std::map<unsigned long, PendingRequest> pending_requests;
+
+    // Hedging: a request still unanswered after the p95 of recent latencies is sent
+    // once more, to an alternate replica; the first response wins and later ones
+    // find nothing pending. At most HEDGE_BUDGET_PERCENT extra requests are sent.
+    static constexpr size_t LATENCY_WINDOW = 128;
+    static constexpr size_t HEDGE_MIN_SAMPLES = 20;
+    static constexpr unsigned long HEDGE_BUDGET_PERCENT = 10;
+    std::array<std::chrono::microseconds, LATENCY_WINDOW> recent_latencies{};
+    size_t latency_samples{0};
+    std::chrono::microseconds hedge_delay{0};    // 0 == not enough samples yet
+    size_t next_hedge_writer{0};
+    DirectHandler direct_handler;
+    StartupTimer* startup_timer{nullptr};
+    std::unique_ptr<ReadinessFd> readiness;   // set == driven by pollOnce() from the caller's loop
+
+    // Application-side counters, read by the stats collector from another thread.
+    std::atomic<unsigned long> pending_count{0};
+    std::atomic<unsigned long> responses_received{0};
+    std::atomic<unsigned long> timeouts{0};
+    std::atomic<unsigned long> hedges_sent{0};
+    std::atomic<unsigned long> current_rate{0};
+
+    std::random_device rd;
+    std::mt19937 gen{rd()};
+    std::uniform_int_distribution<> color_dist{0, 2};
+    std::uniform_int_distribution<> state_dist{0, 1};
+
+    const char* colorToString(led_control::LedColor color)
+    {
+        switch(color)
+        {
+            case led_control::LedColor::RED: return "RED";
+            case led_control::LedColor::GREEN: return "GREEN";
+            case led_control::LedColor::BLUE: return "BLUE";
+            default: return "UNKNOWN";
+        }
+    }
+
+    const char* opToString(const led_control::LedRequest& request)
+    {
+        switch(request.op())
+        {
+            case led_control::LedOp::TOGGLE: return "TOGGLE";
+            case led_control::LedOp::SET_IF_VERSION: return request.state() ? "ON (if version)" : "OFF (if version)";
+            default: return request.state() ? "ON" : "OFF";
+        }
+    }
+
+    unsigned long sendRequest(led_control::LedColor color, bool state)
+    {
+        led_control::LedRequest request;
+        request.color(color);
+        request.state(state);
+        return sendRequest(request);
+    }
+
+    // Assigns the request/client ids and sends.
+    unsigned long sendRequest(led_control::LedRequest& request, Completion done = nullptr)
+    {
+        request.request_id(++request_counter);
+        request.client_id(client_id);
+        request.panel_id(panel_id);
+
+        if(verbose)
+        {
+            if(request.op() == led_control::LedOp::STORE_SCENE || request.op() == led_control::LedOp::RECALL_SCENE)
+            {
+                led_log::out << "Sending request: "
+                          << (request.op() == led_control::LedOp::STORE_SCENE ? "store" : "recall")
+                          << " scene " << request.scene_id()
+                          << " (ID: " << request.request_id() << ")" << led_log::endl;
+            }
+            else if(request.transaction().empty())
+            {
+                led_log::out << "Sending request: "
+                          << colorToString(request.color())
+                          << " -> " << opToString(request)
+                          << " (ID: " << request.request_id() << ")" << led_log::endl;
+            }
+            else
+            {
+                led_log::out << "Sending transaction of " << request.transaction().size()
+                          << " commands (ID: " << request.request_id() << ")" << led_log::endl;
+            }
+        }
+
+        PendingRequest& pending = pending_requests[request.request_id()];
+        pending.sent = std::chrono::steady_clock::now();
+        pending.done = std::move(done);
+        pending.hedgeable = !hedge_writers.empty() && !direct_handler && isIdempotent(request);
+        if(pending.hedgeable)
+        {
+            pending.request = request;
+        }
+        pending_count = pending_requests.size();
+
+        if(direct_handler)
+        {
+            handleResponse(direct_handler(request));
+        }
+        else
+        {
+            led_trace::Span span("client.send", led_trace::traceId(client_id, request.request_id()));
+            LED_PROBE3(request_send, client_id, request.request_id(), static_cast<int>(request.op()));
+            writeRequest(request_writer, request);
+        }
+        return request.request_id();
+    }
+
+    void writeCancel(unsigned long request_id)
+    {
+        led_control::LedCancel cancel;
+        cancel.client_id(client_id);
+        cancel.request_id(request_id);
+
+        auto handle = cancel_writer.register_instance(cancel);
+        cancel_writer.write(cancel, handle);
+        cancel_writer.unregister_instance(handle);
+    }
+
+    static void writeRequest(dds::pub::DataWriter<led_control::LedRequest>& writer,
+                             const led_control::LedRequest& request)
+    {
+        // Unregister right away, so the server's reader can reclaim the instance
+        auto handle = writer.register_instance(request);
+        writer.write(request, handle);
+        writer.unregister_instance(handle);
+    }
+
+    // Safe to execute twice, on two replicas: plain SETs (also as a transaction)
+    // and scene recalls. TOGGLE and SET_IF_VERSION are not.
+    static bool isIdempotent(const led_control::LedRequest& request)
+    {
+        if(request.op() == led_control::LedOp::RECALL_SCENE)
+        {
+            return true;
+        }
+        if(request.op() != led_control::LedOp::SET)
+        {
+            return false;
+        }
+        return std::all_of(request.transaction().begin(), request.transaction().end(),
+                           [](const led_control::LedCommand& command)
+                           {
+                               return command.op() == led_control::LedOp::SET;
+                           });
+    }
+
+    void recordLatency(std::chrono::microseconds latency)
+    {
+        recent_latencies[latency_samples % LATENCY_WINDOW] = latency;
+        ++latency_samples;
+
+        // Re-derive the hedge delay every few samples, not on every response
+        if(latency_samples >= HEDGE_MIN_SAMPLES && latency_samples % 8 == 0)
+        {
+            size_t n = std::min(latency_samples, LATENCY_WINDOW);
+            std::array<std::chrono::microseconds, LATENCY_WINDOW> sorted = recent_latencies;
+            auto p95 = sorted.begin() + (n * 95) / 100;
+            std::nth_element(sorted.begin(), p95, sorted.begin() + n);
+            hedge_delay = *p95;
+        }
+    }
+
+    void hedgePending(std::chrono::steady_clock::time_point now)
+    {
+        if(hedge_writers.empty() || hedge_delay.count() == 0)
+        {
+            return;
+        }
+
+        for (auto& entry : pending_requests)
+        {
+            PendingRequest& pending = entry.second;
+            if(!pending.hedgeable || now - pending.sent < hedge_delay)
+            {
+                continue;
+            }
+            if((hedges_sent + 1) * 100 > request_counter * HEDGE_BUDGET_PERCENT)
+            {
+                break;
+            }
+
+            {
+                led_trace::Span span("client.hedge", led_trace::traceId(client_id, pending.request.request_id()));
+                writeRequest(hedge_writers[next_hedge_writer++ % hedge_writers.size()], pending.request);
+            }
+            pending.hedgeable = false;    // one hedge per request
+            pending.hedged = true;
+            ++hedges_sent;
+        }
+    }
+
+    // Finish a request that got no LedResponse of its own (acked or timed out)
+    void complete(unsigned long request_id, const Completion& done, bool success, const char* message)
+    {
+        if(done)
+        {
+            led_control::LedResponse response;
+            response.request_id(request_id);
+            response.client_id(client_id);
+            response.panel_id(panel_id);
+            response.success(success);
+            response.message(message);
+            done(response);
+        }
+    }
+
+    void firstResponse()
+    {
+        if(startup_timer)
+        {
+            startup_timer->mark("first response");
+            startup_timer->report("led_client");
+            startup_timer = nullptr;
+        }
+    }
+
+    void handleResponse(const led_control::LedResponse& response)
+    {
+        if(response.client_id() != client_id)
+        {
+            return;
+        }
+
+        auto it = pending_requests.find(response.request_id());
+
+        if(it != pending_requests.end())
+        {
+            auto now = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - it->second.sent);
+            led_trace::Tracer::instance().record("client.roundtrip",
+                led_trace::traceId(client_id, response.request_id()), it->second.sent, now);
+            LED_PROBE3(response_match, client_id, response.request_id(), static_cast<long>(elapsed.count()));
+            auto latency = elapsed.count() / 1000;
+            recordLatency(elapsed);
+
+            if(verbose)
+            {
+                led_log::out << "\nReceived response for request ID: " << response.request_id() << led_log::endl;
+                led_log::out << "  Success: " << (response.success() ? "Yes" : "No") << led_log::endl;
+                led_log::out << "  Message: " << response.message() << led_log::endl;
+                led_log::out << "  Color: " << colorToString(response.color()) << led_log::endl;
+                led_log::out << "  State: " << (response.state() ? "ON" : "OFF") << led_log::endl;
+                led_log::out << "  Version: " << response.version() << led_log::endl;
+                for (const auto& led : response.leds())
+                {
+                    led_log::out << "    " << colorToString(led.color()) << ": "
+                              << (led.state() ? "ON" : "OFF") << " (version " << led.version() << ")" << led_log::endl;
+                }
+                led_log::out << "  Latency: " << latency << "ms" << led_log::endl;
+            }
+
+            // The other copy lost the race: withdraw it, if not done already
+            if(it->second.hedged)
+            {
+                writeCancel(response.request_id());
+            }
+
+            Completion done = std::move(it->second.done);
+            pending_requests.erase(it);
+            pending_count = pending_requests.size();
+            ++responses_received;
+            firstResponse();
+
+            if(done)
+            {
+                done(response);
+            }
+        }
+    }
+
+    // Resolve every pending request covered by a cumulative ack at once.
+    void handleAck(const led_control::LedAck& ack)
+    {
+        if(ack.client_id() != client_id)
+        {
+            return;
+        }
+
+        // Entries are taken out of the map before their completion runs
+        unsigned long failed = 0;
+        for (uint32_t id : ack.failed_ids())
+        {
+            auto it = pending_requests.find(id);
+            if(it != pending_requests.end())
+            {
+                Completion done = std::move(it->second.done);
+                pending_requests.erase(it);
+                led_log::err << "Request ID " << id << " failed (acked)" << led_log::endl;
+                ++failed;
+                complete(id, done, false, "Failed (acked)");
+            }
+        }
+
+        unsigned long applied = 0;
+        while(!pending_requests.empty() && pending_requests.begin()->first <= ack.up_to_id())
+        {
+            unsigned long id = pending_requests.begin()->first;
+            Completion done = std::move(pending_requests.begin()->second.done);
+            pending_requests.erase(pending_requests.begin());
+            ++applied;
+            complete(id, done, true, "Applied (acked)");
+        }
+        pending_count = pending_requests.size();
+        responses_received += applied + failed;
+
+        if(applied + failed > 0)
+        {
+            if(verbose)
+            {
+                led_log::out << "\nReceived ack up to request ID: " << ack.up_to_id()
+                             << " (" << applied << " applied, " << failed << " failed)" << led_log::endl;
+            }
+            firstResponse();
+        }
+    }
+
+    void checkResponses()
+    {
+        auto samples = response_reader.select()
+            .state(unreadData())
+            .take();
+
+        for (const auto& sample : samples)
+        {
+            if(sample.info().valid())
+            {
+                // From the server's write until taken here
+                if(sample.data().client_id() == client_id)
+                {
+                    led_trace::recordSince("client.receive", led_trace::traceId(client_id, sample.data().request_id()),
+                                           toSystemClock(sample.info().timestamp()));
+                }
+                handleResponse(sample.data());
+            }
+        }
+
+        auto acks = ack_reader.select()
+            .state(unreadData())
+            .take();
+
+        for (const auto& sample : acks)
+        {
+            if(sample.info().valid())
+            {
+                handleAck(sample.data());
+            }
+        }
+
+        // Check for timeout (5 seconds) - 'erase' request if timed out:
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto it = pending_requests.begin(); it != pending_requests.end(); )
+        {
+            if (now - it->second.sent > std::chrono::seconds(5))
+            {
+                led_log::err << "Timeout for request ID: " << it->first << led_log::endl;
+                LED_PROBE2(request_timeout, client_id, it->first);
+                unsigned long id = it->first;
+                Completion done = std::move(it->second.done);
+                it = pending_requests.erase(it);
+                ++timeouts;
+                complete(id, done, false, "Timeout");
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        pending_count = pending_requests.size();
+
+        hedgePending(now);
+
+        auto reports = load_reader.select()
+            .state(unreadData())
+            .take();
+
+        for (const auto& sample : reports)
+        {
+            if(sample.info().valid() && sample.data().replica() == primary_replica)
+            {
+                adaptRate(sample.data());
+            }
+        }
+    }
+
+    void adaptRate(const led_control::LedLoadReport& report)
+    {
+        if(!rate_controller)
+        {
+            return;
+        }
+
+        unsigned long new_timeouts = timeouts - timeouts_at_last_report;
+        timeouts_at_last_report = timeouts;
+
+        if(rate_controller->onLoadReport(report.queue_depth(), report.service_time_us(),
+                                         report.shed_count(), new_timeouts))
+        {
+            applyRate(rate_controller->currentRate());
+        }
+    }
+
+    void applyRate(double per_second)
+    {
+        request_interval = per_second > 0
+            ? std::chrono::microseconds(std::max(1LL, static_cast<long long>(1e6 / per_second)))
+            : std::chrono::microseconds(0);
+        current_rate = static_cast<unsigned long>(per_second + 0.5);
+    }
+
+    // One step of a demo animation: all three LEDs dimming up and down, out of phase.
+    void streamSetpoints()
+    {
+        ++setpoint_counter;
+        for (int color = 0; color < 3; ++color)
+        {
+            unsigned long phase = (setpoint_counter + color * 170) % 510;
+            uint8_t level = static_cast<uint8_t>(phase < 255 ? phase : 510 - phase);
+            publishSetpoint(static_cast<led_control::LedColor>(color), level > 0, level, panel_id);
+        }
+    }
+
+    void sendRandomRequest()
+    {
+        led_control::LedColor color = static_cast<led_control::LedColor>(color_dist(gen));
+        bool state = state_dist(gen) == 1;
+        sendRequest(color, state);
+    }
+
+    // One round of the client's work: responses, timeouts and hedges, plus random
+    // requests and setpoints that fell due. Returns how soon to come back.
+    std::chrono::microseconds serviceOnce()
+    {
+        // Check for responses
+        checkResponses();
+
+        // Send random requests at the configured rate (if any), catching
+        // up on every one that fell due while we slept.
+        auto now = std::chrono::steady_clock::now();
+        auto poll_interval = std::chrono::microseconds(std::chrono::milliseconds(100));
+
+        if(request_interval.count() > 0)
+        {
+            while(next_request <= now)
+            {
+                sendRandomRequest();    // Turn random LED randomly ON if OFF, or OFF if ON!
+                next_request += request_interval;
+            }
+            poll_interval = std::min(poll_interval, request_interval);
+        }
+
+        // Setpoints are latest-value-wins: after a stall, only send the current one
+        if(setpoint_interval.count() > 0)
+        {
+            if(next_setpoint <= now)
+            {
+                streamSetpoints();
+                next_setpoint = std::max(next_setpoint + setpoint_interval, now);
+            }
+            poll_interval = std::min(poll_interval, setpoint_interval);
+        }
+
+        // Look at pending requests often enough to hedge them on time
+        if(!hedge_writers.empty() && hedge_delay.count() > 0 && !pending_requests.empty())
+        {
+            poll_interval = std::min(poll_interval, std::max(hedge_delay / 4, std::chrono::microseconds(100)));
+        }
+
+        return poll_interval;
+    }
+
+public:
+    LedClient(int domain_id = 0, const LedQosConfig& qos = LedQosConfig(),
+              const std::vector<std::string>& replicas = {})
+        : LedClient(dds::domain::DomainParticipant(domain_id), qos, replicas) {}
+
+    // Attach to an existing participant, e.g. one shared with an in-process LedServer.
+    // With 'replicas' (names of redundant LedServers, see '--replica'), requests go to
+    // the first one and slow idempotent ones are hedged to the others.
+    explicit LedClient(const dds::domain::DomainParticipant& shared_participant,
+                       const LedQosConfig& qos = LedQosConfig(),
+                       const std::vector<std::string>& replicas = {})
+        : participant(shared_participant),
+          request_topic(participant, "led_control_requests"),
+          response_topic(participant, "led_control_responses"),
+          publisher(participant),
+          subscriber(participant),
+          request_publisher(replicas.empty() ? publisher : partitionPublisher(participant, replicas.front())),
+          bulk_publisher(bulkPublisher(participant)),
+          bulk_subscriber(bulkSubscriber(participant)),
+          request_writer(request_publisher, request_topic, qos.writerQos(request_publisher)),
+          response_reader(subscriber, response_topic, qos.readerQos(subscriber)),
+          ack_topic(participant, "led_control_acks"),
+          ack_reader(subscriber, ack_topic, ackReaderQos(subscriber)),
+          setpoint_topic(participant, "led_control_setpoints"),
+          setpoint_writer(bulk_publisher, setpoint_topic, setpointWriterQos(bulk_publisher)),
+          cancel_topic(participant, "led_control_cancels"),
+          cancel_writer(publisher, cancel_topic, cancelWriterQos(publisher)),
+          load_topic(participant, "led_control_load"),
+          load_reader(bulk_subscriber, load_topic, loadReportReaderQos(bulk_subscriber)),
+          primary_replica(replicas.empty() ? "" : replicas.front()) {
+
+        client_id = std::uniform_int_distribution<uint32_t>(1, UINT32_MAX)(gen);
+
+        // Only the primary replica has to be up for us to start; hedges to an
+        // alternate that is not (yet) matched are simply lost.
+        for (size_t i = 1; i < replicas.size(); ++i)
+        {
+            dds::pub::Publisher hedge_publisher = partitionPublisher(participant, replicas[i]);
+            hedge_writers.emplace_back(hedge_publisher, request_topic, qos.writerQos(hedge_publisher));
+        }
+
+        // Wait for server to be available - on both topics, else its first responses
+        // could go out before it has discovered our response reader. Wakes up on
+        // matched-status changes rather than polling.
+        dds::core::cond::StatusCondition writer_matched(request_writer);
+        writer_matched.enabled_statuses(dds::core::status::StatusMask::publication_matched());
+        dds::core::cond::StatusCondition reader_matched(response_reader);
+        reader_matched.enabled_statuses(dds::core::status::StatusMask::subscription_matched());
+
+        dds::core::cond::WaitSet waitset;
+        waitset += writer_matched;
+        waitset += reader_matched;
+
+        while(!waitForMatch(waitset, [this]()
+        {
+            return request_writer.publication_matched_status().current_count() >= 1 &&
+                   response_reader.subscription_matched_status().current_count() >= 1;
+        }, std::chrono::seconds(1)))
+        {
+            // Keep waiting
+        }
+
+        led_log::out << "LED Control Client started" << led_log::endl;
+        led_log::out << "Connected to server" << led_log::endl;
+    }
+
+    // Report startup phases through 'timer' once the first response arrived.
+    // Must be set before run() is started.
+    void setStartupTimer(StartupTimer* timer)
+    {
+        startup_timer = timer;
+    }
+
+    // Send random requests at 'per_second' (0 disables). With 'adaptive', that is
+    // only the ceiling: the rate follows the server's load reports (AIMD).
+    // Must be set before run() is started.
+    void setRequestRate(double per_second, bool adaptive = false)
+    {
+        if(adaptive && per_second > 0)
+        {
+            rate_controller = std::make_unique<RateController>(per_second);
+            applyRate(rate_controller->currentRate());
+        }
+        else
+        {
+            rate_controller.reset();
+            applyRate(per_second);
+        }
+    }
+
+    // Stream setpoints (a dimming animation) at 'per_second' (0 disables).
+    // Must be set before run() is started.
+    void setSetpointRate(double per_second)
+    {
+        setpoint_interval = per_second > 0
+            ? std::chrono::microseconds(std::max(1LL, static_cast<long long>(1e6 / per_second)))
+            : std::chrono::microseconds(0);
+    }
+
+    // Per-request console output. Must be set before run() is started.
+    void setVerbose(bool on)
+    {
+        verbose = on;
+    }
+
+    // Address panel 'id' of a multi-panel server (led_server --panels).
+    // Must be set before run() is started.
+    void setPanel(uint32_t id)
+    {
+        panel_id = id;
+    }
+
+    // Route requests straight to an in-process server instead of over DDS.
+    // Must be set before run() is started.
+    void setDirectHandler(DirectHandler handler)
+    {
+        direct_handler = std::move(handler);
+    }
+
+    void run()
+    {
+        // Send initial test requests - turn ALL the LEDs 'ON':
+        led_log::out << "\n=== Sending Initial Test Requests ===" << led_log::endl;
+        sendRequest(led_control::LedColor::RED, true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        sendRequest(led_control::LedColor::GREEN, true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        sendRequest(led_control::LedColor::BLUE, true);
+
+        next_request = std::chrono::steady_clock::now();
+        next_setpoint = next_request;
+
+        // Main loop
+        while(running)
+        {
+            try
+            {
+                std::this_thread::sleep_for(serviceOnce());
+            }
+            catch(const dds::core::Exception& e)
+            {
+                led_log::err << "DDS Exception: " << e.what() << led_log::endl;
+            }
+        }
+    }
+
+    void stop()
+    {
+        running = false;
+    }
+
+    // Send 'request' (its ids and panel are filled in) and call 'done' with the
+    // outcome from a later pollOnce() (or right away with a direct handler).
+    // For callers driving the client from their own loop instead of run().
+    unsigned long submit(led_control::LedRequest request, Completion done)
+    {
+        return sendRequest(request, std::move(done));
+    }
+
+    // A descriptor that polls readable whenever pollOnce() has work to do:
+    // responses, acks or load reports arrived, or a timeout, hedge or rate-driven
+    // send fell due. Takes over the readers' listeners.
+    int eventFd()
+    {
+        if(!readiness)
+        {
+            readiness = std::make_unique<ReadinessFd>();
+            readiness->watch(response_reader);
+            readiness->watch(ack_reader);
+            readiness->watch(load_reader);
+        }
+        return readiness->fd();
+    }
+
+    // Handle whatever responses, acks, timeouts, hedges and load reports are due,
+    // and send the random requests/setpoints that fell due, without blocking.
+    // Re-arms eventFd()'s timer for the next of those. Not to be mixed with run().
+    void pollOnce()
+    {
+        if(readiness)
+        {
+            readiness->clear();
+        }
+
+        auto next = serviceOnce();
+
+        if(readiness)
+        {
+            readiness->armTimer(next);
+        }
+    }
+
+    // Snapshot of DDS status counters plus application queue depths, as JSON.
+    // Safe to call from any thread (e.g. a StatsEndpoint).
+    std::string statsJson()
+    {
+        auto lost = response_reader.sample_lost_status();
+        auto rejected = response_reader.sample_rejected_status();
+        auto deadline = response_reader.requested_deadline_missed_status();
+        auto readers_matched = response_reader.subscription_matched_status();
+        auto writers_matched = request_writer.publication_matched_status();
+        auto offered_deadline = request_writer.offered_deadline_missed_status();
+
+        char buf[512];
+        std::snprintf(buf, sizeof(buf),
+            "{\"response_reader\":{\"matched\":%d,\"sample_lost\":%d,\"sample_rejected\":%d,"
+            "\"deadline_missed\":%d},"
+            "\"request_writer\":{\"matched\":%d,\"deadline_missed\":%d},"
+            "\"app\":{\"pending\":%lu,\"responses\":%lu,\"timeouts\":%lu,\"hedges\":%lu,"
+            "\"rate\":%lu}}\n",
+            readers_matched.current_count(), lost.total_count(), rejected.total_count(),
+            deadline.total_count(),
+            writers_matched.current_count(), offered_deadline.total_count(),
+            pending_count.load(), responses_received.load(), timeouts.load(), hedges_sent.load(),
+            current_rate.load());
+
+        return buf;
+    }
+
+    // Fire-and-forget update of one LED on 'panel': no request id, no reply,
+    // and superseded values may be dropped in transit.
+    void publishSetpoint(led_control::LedColor color, bool state, uint8_t level, uint32_t panel = 0)
+    {
+        led_control::LedSetpoint setpoint;
+        setpoint.panel_id(panel);
+        setpoint.color(color);
+        setpoint.state(state);
+        setpoint.level(level);
+
+        setpoint_writer.write(setpoint);
+    }
+
+    // Withdraw a request sent earlier (by the id the sending call returned), e.g.
+    // a superseded frame. The server answers "Cancelled" if it gets the cancel
+    // before actuating the request; otherwise the request's normal response stands.
+    void cancel(unsigned long request_id)
+    {
+        if(!direct_handler && pending_requests.count(request_id) > 0)
+        {
+            writeCancel(request_id);
+        }
+    }
+
+    // Server-side read-modify-write: flip the LED, whatever its current state.
+    unsigned long toggle(led_control::LedColor color)
+    {
+        led_control::LedRequest request;
+        request.color(color);
+        request.op(led_control::LedOp::TOGGLE);
+        return sendRequest(request);
+    }
+
+    // Set the LED only if it is still at 'expected_version' (as reported in an
+    // earlier response) - fails instead of overwriting someone else's change.
+    unsigned long compareAndSet(led_control::LedColor color, bool state, uint32_t expected_version)
+    {
+        led_control::LedRequest request;
+        request.color(color);
+        request.state(state);
+        request.op(led_control::LedOp::SET_IF_VERSION);
+        request.expected_version(expected_version);
+        return sendRequest(request);
+    }
+
+    // Apply several commands atomically: all of them or, if any fails, none.
+    unsigned long sendTransaction(const std::vector<led_control::LedCommand>& commands)
+    {
+        led_control::LedRequest request;
+        request.transaction(commands);
+        return sendRequest(request);
+    }
+
+    // Store a scene on the server under 'scene_id', from SET/TOGGLE commands
+    // applied to an all-OFF panel, or - with no commands - from the current state.
+    unsigned long storeScene(uint32_t scene_id, const std::vector<led_control::LedCommand>& commands = {})
+    {
+        led_control::LedRequest request;
+        request.op(led_control::LedOp::STORE_SCENE);
+        request.scene_id(scene_id);
+        request.transaction(commands);
+        return sendRequest(request);
+    }
+
+    // Apply a stored scene: a tiny request, however large the scene.
+    unsigned long recallScene(uint32_t scene_id)
+    {
+        led_control::LedRequest request;
+        request.op(led_control::LedOp::RECALL_SCENE);
+        request.scene_id(scene_id);
+        return sendRequest(request);
+    }
+
+    // Method for manual control (can be called from UI or CLI)
+    unsigned long manualControl(led_control::LedColor color, bool state)
+    {
+        return sendRequest(color, state);
+    }
+};
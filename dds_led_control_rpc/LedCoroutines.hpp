@@ -0,0 +1,272 @@
+#pragma once
+
+/*
+ * C++20 coroutine support for request handlers (LED_ENABLE_COROUTINES).
+ *
+ * A handler that has to wait - for the hardware to finish a flush, for a timer,
+ * for another DDS service - suspends instead of blocking the dispatch thread.
+ * Each waiting request then costs one coroutine frame (a few hundred bytes)
+ * rather than a thread, so thousands can be in progress at once.
+ *
+ * Everything runs on one Executor, driven by the owner's loop: runDue() resumes
+ * what is ready, untilNextTimer() tells how long the loop may sleep. Only post()
+ * (and so Completion::complete()) may be called from other threads.
+ *
+ *     led_co::Task handle(led_co::Executor& executor, ...)
+ *     {
+ *         co_await led_co::sleepFor(executor, std::chrono::milliseconds(10));
+ *         auto response = co_await led_co::request(executor, client, request);
+ *         ...
+ *     }
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "LedControl.hpp"
+#include "LedLog.hpp"
+
+
+namespace led_co
+{
+
+// Fire-and-forget coroutine: starts right away, frees its own frame when done.
+// Exceptions are logged rather than lost - there is nobody to rethrow them to.
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+
+        void unhandled_exception()
+        {
+            try
+            {
+                throw;
+            }
+            catch(const std::exception& e)
+            {
+                led_log::err << "Exception in coroutine handler: " << e.what() << led_log::endl;
+            }
+            catch(...)
+            {
+                led_log::err << "Unknown exception in coroutine handler" << led_log::endl;
+            }
+        }
+    };
+};
+
+
+class Executor
+{
+private:
+    std::mutex mutex;
+    std::deque<std::coroutine_handle<>> ready;     // guarded by 'mutex'
+    std::multimap<std::chrono::steady_clock::time_point, std::coroutine_handle<>> timers;
+    std::function<void()> wakeup;
+
+public:
+    Executor() = default;
+
+    // Coroutines still waiting for a timer or queued to resume are destroyed
+    // here, freeing their frames and whatever those hold. Ones parked on a
+    // Completion are not known to the executor: nothing may complete() them
+    // once it is gone.
+    ~Executor()
+    {
+        for (auto& timer : timers)
+        {
+            timer.second.destroy();
+        }
+        for (auto handle : ready)
+        {
+            handle.destroy();
+        }
+    }
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // Called by post(), so a loop sleeping on something else (a WaitSet, an fd)
+    // notices work arriving from another thread.
+    void setWakeup(std::function<void()> wake)
+    {
+        wakeup = std::move(wake);
+    }
+
+    // Resume 'handle' on the executor's thread. Thread-safe.
+    void post(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(handle);
+        }
+        if(wakeup)
+        {
+            wakeup();
+        }
+    }
+
+    void resumeAt(std::chrono::steady_clock::time_point when, std::coroutine_handle<> handle)
+    {
+        timers.emplace(when, handle);
+    }
+
+    // Resume everything that is ready or whose timer expired. Returns how many.
+    size_t runDue()
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::deque<std::coroutine_handle<>> due;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            due.swap(ready);
+        }
+        while(!timers.empty() && timers.begin()->first <= now)
+        {
+            due.push_back(timers.begin()->second);
+            timers.erase(timers.begin());
+        }
+
+        for (auto handle : due)
+        {
+            handle.resume();
+        }
+        return due.size();
+    }
+
+    // How long the loop may sleep, at most 'limit', without making a timer late.
+    std::chrono::milliseconds untilNextTimer(std::chrono::milliseconds limit) const
+    {
+        if(timers.empty())
+        {
+            return limit;
+        }
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(
+            timers.begin()->first - std::chrono::steady_clock::now());
+        return std::max(std::chrono::milliseconds(0), std::min(limit, left));
+    }
+};
+
+
+// co_await sleepFor(executor, d): resume on the executor once 'd' has passed.
+class Sleep
+{
+private:
+    Executor& executor;
+    std::chrono::steady_clock::time_point deadline;
+
+public:
+    Sleep(Executor& exec, std::chrono::steady_clock::duration delay)
+        : executor(exec), deadline(std::chrono::steady_clock::now() + delay) {}
+
+    bool await_ready() const noexcept
+    {
+        return deadline <= std::chrono::steady_clock::now();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        executor.resumeAt(deadline, handle);
+    }
+
+    void await_resume() const noexcept {}
+};
+
+inline Sleep sleepFor(Executor& executor, std::chrono::steady_clock::duration delay)
+{
+    return Sleep(executor, delay);
+}
+
+
+// One-shot result delivered from outside: a hardware driver's completion
+// callback, a response from another service. Copies share the same result, so
+// one copy goes to whoever completes it while the coroutine co_awaits another.
+// complete() may run on any thread, before or after the co_await.
+template<typename T>
+class Completion
+{
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::optional<T> value;
+        std::coroutine_handle<> waiting;
+    };
+
+    Executor* executor;
+    std::shared_ptr<State> state;
+
+public:
+    explicit Completion(Executor& exec)
+        : executor(&exec), state(std::make_shared<State>()) {}
+
+    void complete(T value)
+    {
+        std::coroutine_handle<> waiting;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if(state->value)
+            {
+                return;     // Completed already
+            }
+            state->value = std::move(value);
+            waiting = std::exchange(state->waiting, nullptr);
+        }
+        if(waiting)
+        {
+            executor->post(waiting);
+        }
+    }
+
+    bool await_ready() const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->value.has_value();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if(state->value)
+        {
+            return false;   // Completed between await_ready() and now
+        }
+        state->waiting = handle;
+        return true;
+    }
+
+    T await_resume()
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return std::move(*state->value);
+    }
+};
+
+
+// co_await request(executor, client, request): a request to a downstream LED
+// service through a LedClient driven on the same thread (its pollOnce() part of
+// the loop), resuming with the response - or the client's timeout response.
+template<typename Client>
+Completion<led_control::LedResponse> request(Executor& executor, Client& client, led_control::LedRequest request)
+{
+    Completion<led_control::LedResponse> completion(executor);
+    client.submit(std::move(request), [completion](const led_control::LedResponse& response) mutable
+    {
+        completion.complete(response);
+    });
+    return completion;
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+/*
+ * Console logging used by all executables: 'led_log::out << ... << led_log::endl'.
+ *
+ * Normally this is plain std::cout/std::cerr. The low-memory profile
+ * (LED_LOW_MEMORY) swaps in a tiny line writer on the raw file descriptors, so
+ * no iostreams (static init, locale, stream buffers) get linked in by our code.
+ */
+
+#if LED_LOW_MEMORY
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <unistd.h>
+
+namespace led_log
+{
+
+class Stream
+{
+private:
+    struct Line
+    {
+        char data[256];
+        size_t len = 0;
+    };
+
+    int fd;
+
+    // One pending line per thread and stream: no locking, and every line goes
+    // out in a single write() so lines from different threads don't interleave.
+    Line& line()
+    {
+        thread_local Line lines[2];
+        return lines[fd == STDERR_FILENO ? 1 : 0];
+    }
+
+    Stream& append(const char* s, size_t n)
+    {
+        Line& l = line();
+        while(n > 0)
+        {
+            size_t chunk = std::min(n, sizeof(l.data) - l.len);
+            std::memcpy(l.data + l.len, s, chunk);
+            l.len += chunk;
+            s += chunk;
+            n -= chunk;
+            if(l.len == sizeof(l.data))
+            {
+                flush();
+            }
+        }
+        return *this;
+    }
+
+    template<typename T>
+    Stream& format(const char* fmt, T value)
+    {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), fmt, value);
+        return append(buf, static_cast<size_t>(n));
+    }
+
+public:
+    explicit Stream(int file_descriptor) : fd(file_descriptor) {}
+
+    Stream& operator<<(const char* s) { return append(s, std::strlen(s)); }
+    Stream& operator<<(const std::string& s) { return append(s.data(), s.size()); }
+    Stream& operator<<(char c) { return append(&c, 1); }
+    Stream& operator<<(int v) { return format("%d", v); }
+    Stream& operator<<(unsigned int v) { return format("%u", v); }
+    Stream& operator<<(long v) { return format("%ld", v); }
+    Stream& operator<<(unsigned long v) { return format("%lu", v); }
+    Stream& operator<<(long long v) { return format("%lld", v); }
+    Stream& operator<<(unsigned long long v) { return format("%llu", v); }
+    Stream& operator<<(double v) { return format("%g", v); }
+    Stream& operator<<(Stream& (*manipulator)(Stream&)) { return manipulator(*this); }
+
+    void flush()
+    {
+        Line& l = line();
+        if(l.len > 0)
+        {
+            (void)::write(fd, l.data, l.len);
+            l.len = 0;
+        }
+    }
+};
+
+inline Stream& endl(Stream& stream)
+{
+    stream << '\n';
+    stream.flush();
+    return stream;
+}
+
+inline Stream out{STDOUT_FILENO};
+inline Stream err{STDERR_FILENO};
+
+}
+
+#else
+
+#include <iostream>
+
+namespace led_log
+{
+
+inline std::ostream& out = std::cout;
+inline std::ostream& err = std::cerr;
+
+inline std::ostream& endl(std::ostream& stream)
+{
+    return std::endl(stream);
+}
+
+}
+
+#endif
@@ -0,0 +1,384 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include "LedControl.hpp"
+#include "LedLog.hpp"
+#include "LedTrace.hpp"
+#include "LedProbes.hpp"
+
+
+/*
+ * The simulated LED panels and everything that applies requests and setpoints
+ * to them: LED state, versions, scenes and the hardware flush. No DDS entities
+ * here - LedServer serves these over DDS, led_raw_server over plain sockets.
+ */
+class LedPanels
+{
+private:
+    // Stored scenes, precomputed at upload into the exact output form, so a recall
+    // is a copy into the state/output buffers plus one hardware flush, however the
+    // scene was described.
+    struct Scene
+    {
+        bool states[3];
+        uint8_t levels[3];
+        uint8_t output[3];
+    };
+
+    static constexpr size_t MAX_SCENES = 256;
+
+    // One simulated 3-LED panel. Each has its own lock - requests may be applied
+    // from several threads at once - so panels don't contend. Requests for a panel
+    // are applied in the order they are handed in.
+    struct Panel
+    {
+        std::mutex mutex;
+        bool states[3] = {false, false, false};  // RED, GREEN, BLUE
+        uint8_t levels[3] = {255, 255, 255};      // brightness, set by setpoints
+        uint32_t versions[3] = {0, 0, 0};         // bumped on every change, for SET_IF_VERSION
+
+        // What actually gets driven to the LED hardware: PWM duty per LED
+        // (level when ON, 0 when OFF). Kept in sync with the state above.
+        uint8_t output[3] = {0, 0, 0};
+
+        // Scenes are per panel: a look across several panels is recalled panel by panel
+        std::map<uint32_t, Scene> scenes;
+    };
+
+    // Indexed by panel id. Sized before serving starts and never resized after.
+    std::vector<Panel> panels = std::vector<Panel>(1);
+
+    // Simulated time to flush a panel's output to the hardware, per request
+    std::chrono::microseconds actuation_delay{std::chrono::milliseconds(10)};
+
+public:
+    static const char* colorToString(led_control::LedColor color)
+    {
+        switch(color) {
+            case led_control::LedColor::RED: return "RED";
+            case led_control::LedColor::GREEN: return "GREEN";
+            case led_control::LedColor::BLUE: return "BLUE";
+            default: return "UNKNOWN";
+        }
+    }
+
+private:
+    // Apply 'commands' in order, all-or-nothing (caller holds panel.mutex): they run
+    // on a copy of the LED state, which only replaces the real one if every command
+    // succeeds. Fills in the response's status fields.
+    bool applyCommands(Panel& panel, const std::vector<led_control::LedCommand>& commands,
+                       led_control::LedResponse& response, bool report_each)
+    {
+        bool states[3];
+        uint32_t versions[3];
+        std::copy(std::begin(panel.states), std::end(panel.states), states);
+        std::copy(std::begin(panel.versions), std::end(panel.versions), versions);
+
+        std::vector<led_control::LedStatus> results;
+
+        for (const auto& command : commands)
+        {
+            int color_index = static_cast<int>(command.color());
+            if(color_index < 0 || color_index > 2)
+            {
+                response.message("Invalid LED color");
+                return false;
+            }
+            if(command.op() == led_control::LedOp::STORE_SCENE || command.op() == led_control::LedOp::RECALL_SCENE)
+            {
+                response.message("Scene operations are not allowed in a transaction");
+                return false;
+            }
+
+            bool next = command.state();
+            if(command.op() == led_control::LedOp::TOGGLE)
+            {
+                next = !states[color_index];
+            }
+            else if(command.op() == led_control::LedOp::SET_IF_VERSION &&
+                    versions[color_index] != command.expected_version())
+            {
+                response.message(std::string("Version mismatch on ") + colorToString(command.color()) +
+                                 ": expected " + std::to_string(command.expected_version()) +
+                                 ", current " + std::to_string(versions[color_index]));
+                response.color(command.color());
+                response.state(states[color_index]);
+                response.version(versions[color_index]);
+                return false;
+            }
+
+            if(states[color_index] != next)
+            {
+                states[color_index] = next;
+                ++versions[color_index];
+            }
+
+            response.color(command.color());
+            response.state(next);
+            response.version(versions[color_index]);
+
+            if(report_each)
+            {
+                led_control::LedStatus status;
+                status.color(command.color());
+                status.state(next);
+                status.version(versions[color_index]);
+                results.push_back(status);
+            }
+        }
+
+        std::copy(std::begin(states), std::end(states), panel.states);
+        std::copy(std::begin(versions), std::end(versions), panel.versions);
+        updateOutput(panel);
+
+        response.leds(results);
+        response.message("LED control successful");
+        return true;
+    }
+
+    static uint8_t outputFor(bool state, uint8_t level)
+    {
+        return state ? level : 0;
+    }
+
+    static void updateOutput(Panel& panel)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            panel.output[i] = outputFor(panel.states[i], panel.levels[i]);
+        }
+    }
+
+    // Caller holds panel.mutex. An empty command list snapshots the current state;
+    // otherwise the commands are applied to an all-OFF panel.
+    bool storeScene(Panel& panel, uint32_t scene_id, const std::vector<led_control::LedCommand>& commands,
+                    led_control::LedResponse& response)
+    {
+        if(panel.scenes.size() >= MAX_SCENES && panel.scenes.count(scene_id) == 0)
+        {
+            response.message("Scene storage full");
+            return false;
+        }
+
+        Scene scene;
+        if(commands.empty())
+        {
+            std::copy(std::begin(panel.states), std::end(panel.states), scene.states);
+            std::copy(std::begin(panel.levels), std::end(panel.levels), scene.levels);
+        }
+        else
+        {
+            std::fill(std::begin(scene.states), std::end(scene.states), false);
+            std::copy(std::begin(panel.levels), std::end(panel.levels), scene.levels);
+
+            for (const auto& command : commands)
+            {
+                int color_index = static_cast<int>(command.color());
+                if(color_index < 0 || color_index > 2 ||
+                   (command.op() != led_control::LedOp::SET && command.op() != led_control::LedOp::TOGGLE))
+                {
+                    response.message("Scenes may only contain SET/TOGGLE commands on valid LEDs");
+                    return false;
+                }
+                scene.states[color_index] = command.op() == led_control::LedOp::TOGGLE
+                    ? !scene.states[color_index]
+                    : command.state();
+            }
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            scene.output[i] = outputFor(scene.states[i], scene.levels[i]);
+        }
+
+        panel.scenes[scene_id] = scene;
+        response.message("Scene " + std::to_string(scene_id) + " stored");
+        return true;
+    }
+
+    // Caller holds panel.mutex.
+    bool recallScene(Panel& panel, uint32_t scene_id, led_control::LedResponse& response)
+    {
+        auto it = panel.scenes.find(scene_id);
+        if(it == panel.scenes.end())
+        {
+            response.message("Unknown scene " + std::to_string(scene_id));
+            return false;
+        }
+
+        const Scene& scene = it->second;
+        for (int i = 0; i < 3; ++i)
+        {
+            if(panel.states[i] != scene.states[i] || panel.levels[i] != scene.levels[i])
+            {
+                ++panel.versions[i];
+            }
+        }
+        std::memcpy(panel.states, scene.states, sizeof(panel.states));
+        std::memcpy(panel.levels, scene.levels, sizeof(panel.levels));
+        std::memcpy(panel.output, scene.output, sizeof(panel.output));
+
+        response.message("Scene " + std::to_string(scene_id) + " recalled");
+        return true;
+    }
+
+public:
+    size_t size() const
+    {
+        return panels.size();
+    }
+
+    // Host 'count' independent panels, addressed by panel_id 0 .. count-1.
+    // Not thread-safe: call before serving starts.
+    void resize(size_t count)
+    {
+        panels = std::vector<Panel>(std::max<size_t>(count, 1));
+    }
+
+    // Simulated per-request actuation time. Set before serving starts.
+    void setActuationDelay(std::chrono::microseconds delay)
+    {
+        actuation_delay = delay;
+    }
+
+    std::chrono::microseconds actuationDelay() const
+    {
+        return actuation_delay;
+    }
+
+    // Apply a request to the (simulated) hardware and build its response.
+    // Thread-safe.
+    led_control::LedResponse handleRequest(const led_control::LedRequest& request)
+    {
+        led_control::LedResponse response = applyRequest(request);
+
+        // Simulate flushing the panel's output to the hardware
+        if(response.success() && actuation_delay.count() > 0)
+        {
+            led_trace::Span span("server.actuation", led_trace::traceId(request.client_id(), request.request_id()));
+            LED_PROBE2(actuation_start, request.client_id(), request.request_id());
+            std::this_thread::sleep_for(actuation_delay);
+            LED_PROBE2(actuation_end, request.client_id(), request.request_id());
+        }
+
+        return response;
+    }
+
+    // handleRequest() up to, not including, the hardware flush. Thread-safe.
+    led_control::LedResponse applyRequest(const led_control::LedRequest& request)
+    {
+        led_trace::Span span("server.apply", led_trace::traceId(request.client_id(), request.request_id()));
+
+        // Prepare response
+        led_control::LedResponse response;
+        response.color(request.color());
+        response.state(request.state());
+        response.request_id(request.request_id());
+        response.client_id(request.client_id());
+        response.panel_id(request.panel_id());
+
+        if(request.panel_id() >= panels.size())
+        {
+            response.success(false);
+            response.message("Unknown panel " + std::to_string(request.panel_id()));
+            return response;
+        }
+
+        {
+            Panel& panel = panels[request.panel_id()];
+            std::lock_guard<std::mutex> lock(panel.mutex);
+
+            // Simulate hardware control - read-modify-write happens here, under the
+            // lock, so concurrent clients can't lose each other's updates
+            if(request.op() == led_control::LedOp::STORE_SCENE)
+            {
+                // Nothing to drive to the hardware
+                response.success(storeScene(panel, request.scene_id(), request.transaction(), response));
+                return response;
+            }
+            else if(request.op() == led_control::LedOp::RECALL_SCENE)
+            {
+                response.success(recallScene(panel, request.scene_id(), response));
+            }
+            else if(!request.transaction().empty())
+            {
+                response.success(applyCommands(panel, request.transaction(), response, true));
+            }
+            else
+            {
+                led_control::LedCommand command;
+                command.color(request.color());
+                command.op(request.op());
+                command.state(request.state());
+                command.expected_version(request.expected_version());
+
+                response.success(applyCommands(panel, {command}, response, false));
+            }
+        }
+
+        return response;
+    }
+
+    // Apply a streaming setpoint (newest value per LED, no reply). Returns false
+    // for a panel or LED not hosted here. Thread-safe.
+    bool applySetpoint(const led_control::LedSetpoint& setpoint)
+    {
+        int color_index = static_cast<int>(setpoint.color());
+        if(setpoint.panel_id() >= panels.size() || color_index < 0 || color_index > 2)
+        {
+            return false;
+        }
+
+        Panel& panel = panels[setpoint.panel_id()];
+        std::lock_guard<std::mutex> lock(panel.mutex);
+
+        if(panel.states[color_index] != setpoint.state() || panel.levels[color_index] != setpoint.level())
+        {
+            panel.states[color_index] = setpoint.state();
+            panel.levels[color_index] = setpoint.level();
+            panel.output[color_index] = outputFor(setpoint.state(), setpoint.level());
+            ++panel.versions[color_index];
+        }
+        return true;
+    }
+
+    // Print the current LED states to the console
+    void display()
+    {
+        // With many panels, only show the first few
+        static constexpr size_t MAX_DISPLAYED = 4;
+        static const char* const names[3] = {"RED", "GREEN", "BLUE"};
+
+        for (size_t id = 0; id < std::min(panels.size(), MAX_DISPLAYED); ++id)
+        {
+            Panel& panel = panels[id];
+            std::lock_guard<std::mutex> lock(panel.mutex);
+
+            led_log::out << "\nCurrent LED States";
+            if(panels.size() > 1)
+            {
+                led_log::out << " (panel " << static_cast<unsigned long>(id) << ")";
+            }
+            led_log::out << ":" << led_log::endl;
+            for (int i = 0; i < 3; ++i)
+            {
+                led_log::out << names[i] << ": " << (panel.states[i] ? "ON" : "OFF")
+                             << " (level " << static_cast<int>(panel.levels[i]) << ")" << led_log::endl;
+            }
+        }
+        if(panels.size() > MAX_DISPLAYED)
+        {
+            led_log::out << "... and " << static_cast<unsigned long>(panels.size() - MAX_DISPLAYED)
+                         << " more panels" << led_log::endl;
+        }
+    }
+};
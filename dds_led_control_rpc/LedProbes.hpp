@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ * USDT (user-level statically defined tracing) probes on the request hot paths,
+ * for attaching bpftrace/perf to a running led_server/led_client:
+ *
+ *     sudo bpftrace -l 'usdt:./led_server:led:*'
+ *     sudo bpftrace scripts/bpftrace/server_latency.bt
+ *
+ * A probe site is a single nop until something attaches to it. Built in when
+ * sys/sdt.h (systemtap-sdt-dev / systemtap-sdt-devel) is found - see
+ * LED_ENABLE_USDT in CMakeLists.txt - and a no-op otherwise.
+ *
+ * Provider 'led'. Arguments are integers; client/request ids identify a request:
+ *
+ *     request_receive  (client_id, request_id, panel_id, op)     server, as taken
+ *     actuation_start  (client_id, request_id)                   server
+ *     actuation_end    (client_id, request_id)                   server
+ *     response_write   (client_id, request_id, success)          server
+ *     ack_record       (client_id, request_id, success)          server, ack mode
+ *     request_send     (client_id, request_id, op)               client
+ *     response_match   (client_id, request_id, latency_us)       client
+ *     request_timeout  (client_id, request_id)                   client
+ */
+
+#if LED_ENABLE_USDT
+
+#include <sys/sdt.h>
+
+#define LED_PROBE2(name, a, b)          DTRACE_PROBE2(led, name, a, b)
+#define LED_PROBE3(name, a, b, c)       DTRACE_PROBE3(led, name, a, b, c)
+#define LED_PROBE4(name, a, b, c, d)    DTRACE_PROBE4(led, name, a, b, c, d)
+
+#else
+
+#define LED_PROBE2(name, a, b)          do {} while(0)
+#define LED_PROBE3(name, a, b, c)       do {} while(0)
+#define LED_PROBE4(name, a, b, c, d)    do {} while(0)
+
+#endif
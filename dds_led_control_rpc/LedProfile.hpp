@@ -0,0 +1,151 @@
+#pragma once
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+#include "LedLog.hpp"
+
+
+// Where the bundled Cyclone DDS configurations are installed (set by CMake),
+// that directory relative to the installed executables, and the source tree's
+// copy for running straight from a build directory.
+#ifndef LED_CONFIG_DIR
+#define LED_CONFIG_DIR "/usr/local/share/led_control"
+#endif
+#ifndef LED_CONFIG_RELDIR
+#define LED_CONFIG_RELDIR "../share/led_control"
+#endif
+#ifndef LED_SOURCE_CONFIG_DIR
+#define LED_SOURCE_CONFIG_DIR "config"
+#endif
+
+
+// config/cyclonedds-NAME.xml as a file:// URI, or "" if it can't be found.
+// Looked for in $LED_CONFIG_DIR, next to the executable (so an installed tree
+// still works when copied to another prefix, e.g. onto a controller), in the
+// install directory, and in the source tree - in that order.
+inline std::string cycloneConfigUri(const std::string& name)
+{
+    std::string dirs[4];
+    size_t count = 0;
+
+    if(const char* dir = std::getenv("LED_CONFIG_DIR"))
+    {
+        dirs[count++] = dir;
+    }
+    char exe[PATH_MAX];
+    ssize_t length = ::readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if(length > 0)
+    {
+        std::string path(exe, static_cast<size_t>(length));
+        dirs[count++] = path.substr(0, path.rfind('/') + 1) + LED_CONFIG_RELDIR;
+    }
+    dirs[count++] = LED_CONFIG_DIR;
+    dirs[count++] = LED_SOURCE_CONFIG_DIR;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string file = dirs[i] + "/cyclonedds-" + name + ".xml";
+        if(::access(file.c_str(), R_OK) == 0)
+        {
+            return "file://" + file;
+        }
+    }
+    return "";
+}
+
+
+// Deployment profiles selectable with '--profile NAME[,NAME...]', each bundled
+// as config/cyclonedds-NAME.xml (see the comments in those files, and
+// scripts/bench_profiles.sh for measuring them). 'isolation' is an overlay to
+// list after a base profile.
+inline bool isCycloneProfile(const char* names)
+{
+    static const char* const profiles[] = {"loopback", "lan-unicast", "lan-multicast", "lowmem", "isolation"};
+    for (const char* name = names; ; ++name)
+    {
+        size_t length = std::strcspn(name, ",");
+        bool known = false;
+        for (const char* profile : profiles)
+        {
+            known = known || (std::strlen(profile) == length && std::strncmp(name, profile, length) == 0);
+        }
+        if(!known)
+        {
+            return false;
+        }
+        name += length;
+        if(*name == '\0')
+        {
+            return true;
+        }
+    }
+}
+
+
+inline const char* cycloneProfileUsage()
+{
+    return "[--profile loopback|lan-unicast|lan-multicast|lowmem[,isolation]]";
+}
+
+
+// Point Cyclone at the configuration(s) for 'profile' (from --profile), or with
+// none given at the one matching the build profile. Must run before the first
+// DomainParticipant is created.
+//
+// Explicit profiles are applied in order and any CYCLONEDDS_URI from the
+// environment on top of them (Cyclone merges a comma-separated list in order),
+// so site settings such as interfaces or peers still win. Without one, an
+// existing CYCLONEDDS_URI is left alone.
+//
+// Returns false, after logging which file is missing, if a profile's
+// configuration can't be found: Cyclone would otherwise quietly run with its
+// defaults instead.
+inline bool useProfileCycloneConfig(const char* profile = nullptr)
+{
+    if(profile)
+    {
+        std::string uri;
+        for (const char* name = profile; *name != '\0'; )
+        {
+            size_t length = std::strcspn(name, ",");
+            std::string file = cycloneConfigUri(std::string(name, length));
+            if(file.empty())
+            {
+                led_log::err << "Error: cyclonedds-" << std::string(name, length) << ".xml not found "
+                             << "(install config/ or set LED_CONFIG_DIR)" << led_log::endl;
+                return false;
+            }
+            uri += (uri.empty() ? "" : ",") + file;
+            name += length + (name[length] == ',' ? 1 : 0);
+        }
+        const char* site = std::getenv("CYCLONEDDS_URI");
+        if(site && *site)
+        {
+            uri += std::string(",") + site;
+        }
+        setenv("CYCLONEDDS_URI", uri.c_str(), 1);
+        return true;
+    }
+
+#if LED_LOW_MEMORY
+    if(!std::getenv("CYCLONEDDS_URI"))
+    {
+        std::string uri = cycloneConfigUri("lowmem");
+        if(uri.empty())
+        {
+            led_log::err << "Warning: cyclonedds-lowmem.xml not found, using Cyclone's defaults "
+                         << "(install config/ or set LED_CONFIG_DIR)" << led_log::endl;
+        }
+        else
+        {
+            setenv("CYCLONEDDS_URI", uri.c_str(), 0);
+        }
+    }
+#endif
+    return true;
+}
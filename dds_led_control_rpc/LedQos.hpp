@@ -0,0 +1,325 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+/* Include the C++ DDS API. */
+#include "dds/dds.hpp"
+#include "dds/dds.h"
+
+
+/*
+ * Control traffic (requests, responses, acks, cancels) is kept apart from bulk
+ * streams (setpoints, load reports, and any future state or telemetry topic),
+ * so a busy stream cannot delay a reply:
+ * - control writers carry a TransportPriority above the synchronous delivery
+ *   threshold of config/cyclonedds-isolation.xml, so Cyclone hands their
+ *   samples to readers straight from the receive thread instead of queueing
+ *   them behind bulk samples in the shared delivery queue;
+ * - bulk topics live in their own partition, which that configuration maps to
+ *   a separate multicast address, received by a separate thread.
+ * Without that configuration these are plain QoS settings and change nothing.
+ */
+constexpr int32_t CONTROL_TRANSPORT_PRIORITY = 10;
+constexpr const char* BULK_PARTITION = "led.bulk";
+
+
+/*
+ * History and resource limits shared by the four request/response endpoints
+ * (request reader + response writer on the server, request writer + response
+ * reader on the client). Bounding these keeps reader/writer caches - and thus
+ * memory - fixed under a request flood.
+ */
+struct LedQosConfig
+{
+    static constexpr int32_t UNLIMITED = -1;   // DDS LENGTH_UNLIMITED
+
+    enum class Reliability { Default, Reliable, BestEffort };
+
+    bool keep_all = false;
+    int32_t history_depth = 1;
+    int32_t max_samples = UNLIMITED;
+    int32_t max_instances = UNLIMITED;
+    int32_t max_samples_per_instance = UNLIMITED;
+    int32_t lifespan_ms = 0;    // 0 == written samples never expire
+    Reliability reliability = Reliability::Default;   // Default == DDS defaults per entity kind
+
+    static const char* usage()
+    {
+        return "[--history N|all] [--max-samples N] [--max-instances N] [--max-samples-per-instance N] [--lifespan-ms N] [--reliability reliable|best-effort]";
+    }
+
+    // Consume the option at argv[i] (and its value) if it is one of ours.
+    // Returns false for options that belong to someone else, or invalid values,
+    // which leave the configuration unchanged.
+    bool parseArg(int argc, char** argv, int& i)
+    {
+        if(i + 1 >= argc)
+        {
+            return false;
+        }
+
+        const char* value = argv[i + 1];
+        bool ok = false;
+
+        if(std::strcmp(argv[i], "--history") == 0)
+        {
+            if(std::strcmp(value, "all") == 0)
+            {
+                keep_all = ok = true;
+            }
+            else if(parseCount(value, history_depth))
+            {
+                keep_all = false;
+                ok = true;
+            }
+        }
+        else if(std::strcmp(argv[i], "--max-samples") == 0)
+        {
+            ok = parseCount(value, max_samples);
+        }
+        else if(std::strcmp(argv[i], "--max-instances") == 0)
+        {
+            ok = parseCount(value, max_instances);
+        }
+        else if(std::strcmp(argv[i], "--max-samples-per-instance") == 0)
+        {
+            ok = parseCount(value, max_samples_per_instance);
+        }
+        else if(std::strcmp(argv[i], "--lifespan-ms") == 0)
+        {
+            ok = parseCount(value, lifespan_ms);
+        }
+        else if(std::strcmp(argv[i], "--reliability") == 0)
+        {
+            ok = std::strcmp(value, "reliable") == 0 || std::strcmp(value, "best-effort") == 0;
+            if(ok)
+            {
+                reliability = value[0] == 'r' ? Reliability::Reliable : Reliability::BestEffort;
+            }
+        }
+
+        if(ok)
+        {
+            ++i;
+        }
+        return ok;
+    }
+
+    // Reject combinations DDS would refuse at entity creation, with a readable message.
+    void validate() const
+    {
+        if(max_samples != UNLIMITED && max_samples_per_instance != UNLIMITED &&
+           max_samples < max_samples_per_instance)
+        {
+            throw std::invalid_argument("--max-samples must be >= --max-samples-per-instance");
+        }
+        if(!keep_all && max_samples_per_instance != UNLIMITED &&
+           history_depth > max_samples_per_instance)
+        {
+            throw std::invalid_argument("--history depth must be <= --max-samples-per-instance");
+        }
+    }
+
+    template<typename Qos>
+    void applyTo(Qos& qos) const
+    {
+        qos << (keep_all ? dds::core::policy::History::KeepAll()
+                         : dds::core::policy::History::KeepLast(history_depth))
+            << dds::core::policy::ResourceLimits(max_samples, max_instances, max_samples_per_instance);
+
+        // Both ends need the same setting: a reliable writer still only delivers
+        // best effort to a best-effort reader (the DDS default for readers).
+        if(reliability == Reliability::Reliable)
+        {
+            qos << dds::core::policy::Reliability::Reliable();
+        }
+        else if(reliability == Reliability::BestEffort)
+        {
+            qos << dds::core::policy::Reliability::BestEffort();
+        }
+    }
+
+    dds::sub::qos::DataReaderQos readerQos(const dds::sub::Subscriber& subscriber) const
+    {
+        dds::sub::qos::DataReaderQos qos = subscriber.default_datareader_qos();
+        applyTo(qos);
+        return qos;
+    }
+
+    dds::pub::qos::DataWriterQos writerQos(const dds::pub::Publisher& publisher) const
+    {
+        dds::pub::qos::DataWriterQos qos = publisher.default_datawriter_qos();
+        applyTo(qos);
+        qos << dds::core::policy::TransportPriority(CONTROL_TRANSPORT_PRIORITY);
+        // Requests (or responses) nobody has taken within the lifespan are dropped
+        // by the middleware instead of being delivered late.
+        if(lifespan_ms > 0)
+        {
+            qos << dds::core::policy::Lifespan(dds::core::Duration::from_millisecs(lifespan_ms));
+        }
+        return qos;
+    }
+
+private:
+    static bool parseCount(const char* value, int32_t& count)
+    {
+        char* end = nullptr;
+        long parsed = std::strtol(value, &end, 10);
+        if(end == value || *end != '\0' || parsed < 1 || parsed > INT32_MAX)
+        {
+            return false;
+        }
+        count = static_cast<int32_t>(parsed);
+        return true;
+    }
+};
+
+
+// Unread samples regardless of instance state. Every request/response is its
+// own instance and writers unregister it straight after writing (so readers can
+// reclaim it), which means data may already be NOT_ALIVE when it is taken.
+inline dds::sub::status::DataState unreadData()
+{
+    return dds::sub::status::DataState(dds::sub::status::SampleState::not_read(),
+                                       dds::sub::status::ViewState::any(),
+                                       dds::sub::status::InstanceState::any());
+}
+
+
+// A DDS source timestamp (wall clock of the writer) as a system_clock time.
+inline std::chrono::system_clock::time_point toSystemClock(const dds::core::Time& time)
+{
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(time.sec()) + std::chrono::nanoseconds(time.nanosec())));
+}
+
+
+// Cyclone's own statistics for a writer: bytes retransmitted after NACKs, and
+// how often it was throttled by a full history cache. Zero if unavailable.
+struct WriterRetransmits
+{
+    unsigned long long rexmit_bytes = 0;
+    unsigned long throttle_count = 0;
+};
+
+inline WriterRetransmits writerRetransmits(dds_entity_t writer)
+{
+    WriterRetransmits counters;
+    dds_statistics* stats = dds_create_statistics(writer);
+    if(!stats)
+    {
+        return counters;
+    }
+    dds_refresh_statistics(stats);
+    if(const dds_stat_keyvalue* rexmit = dds_lookup_statistic(stats, "rexmit_bytes"))
+    {
+        counters.rexmit_bytes = rexmit->u.u64;
+    }
+    if(const dds_stat_keyvalue* throttled = dds_lookup_statistic(stats, "throttle_count"))
+    {
+        counters.throttle_count = throttled->u.u32;
+    }
+    dds_delete_statistics(stats);
+    return counters;
+}
+
+
+// Cumulative acks are low-rate, and a failure is only reported in one of them:
+// reliable, with nothing dropped from history.
+inline dds::pub::qos::DataWriterQos ackWriterQos(const dds::pub::Publisher& publisher)
+{
+    dds::pub::qos::DataWriterQos qos = publisher.default_datawriter_qos();
+    qos << dds::core::policy::Reliability::Reliable()
+        << dds::core::policy::History::KeepAll()
+        << dds::core::policy::TransportPriority(CONTROL_TRANSPORT_PRIORITY);
+    return qos;
+}
+
+inline dds::sub::qos::DataReaderQos ackReaderQos(const dds::sub::Subscriber& subscriber)
+{
+    dds::sub::qos::DataReaderQos qos = subscriber.default_datareader_qos();
+    qos << dds::core::policy::Reliability::Reliable()
+        << dds::core::policy::History::KeepAll();
+    return qos;
+}
+
+
+// Cancels are rare and only useful if they arrive: reliable, nothing dropped.
+inline dds::pub::qos::DataWriterQos cancelWriterQos(const dds::pub::Publisher& publisher)
+{
+    return ackWriterQos(publisher);
+}
+
+inline dds::sub::qos::DataReaderQos cancelReaderQos(const dds::sub::Subscriber& subscriber)
+{
+    return ackReaderQos(subscriber);
+}
+
+
+// Requests for a named server replica travel in their own partition, so each
+// replica only sees the copies addressed to it. "" is the default partition.
+inline dds::pub::Publisher partitionPublisher(const dds::domain::DomainParticipant& participant,
+                                              const std::string& partition)
+{
+    dds::pub::qos::PublisherQos qos = participant.default_publisher_qos();
+    qos << dds::core::policy::Partition(partition);
+    return dds::pub::Publisher(participant, qos);
+}
+
+inline dds::sub::Subscriber partitionSubscriber(const dds::domain::DomainParticipant& participant,
+                                                const std::string& partition)
+{
+    dds::sub::qos::SubscriberQos qos = participant.default_subscriber_qos();
+    qos << dds::core::policy::Partition(partition);
+    return dds::sub::Subscriber(participant, qos);
+}
+
+
+// Publisher and subscriber for bulk topics, in BULK_PARTITION.
+inline dds::pub::Publisher bulkPublisher(const dds::domain::DomainParticipant& participant)
+{
+    return partitionPublisher(participant, BULK_PARTITION);
+}
+
+inline dds::sub::Subscriber bulkSubscriber(const dds::domain::DomainParticipant& participant)
+{
+    return partitionSubscriber(participant, BULK_PARTITION);
+}
+
+
+// Setpoints are latest-value-wins: best effort, and only the newest sample per
+// LED kept anywhere, so stale intermediate values are dropped by the middleware.
+// They are bulk traffic: use bulkPublisher()/bulkSubscriber().
+inline dds::pub::qos::DataWriterQos setpointWriterQos(const dds::pub::Publisher& publisher)
+{
+    dds::pub::qos::DataWriterQos qos = publisher.default_datawriter_qos();
+    qos << dds::core::policy::Reliability::BestEffort()
+        << dds::core::policy::History::KeepLast(1);
+    return qos;
+}
+
+inline dds::sub::qos::DataReaderQos setpointReaderQos(const dds::sub::Subscriber& subscriber)
+{
+    dds::sub::qos::DataReaderQos qos = subscriber.default_datareader_qos();
+    qos << dds::core::policy::Reliability::BestEffort()
+        << dds::core::policy::History::KeepLast(1);
+    return qos;
+}
+
+
+// Load reports are periodic and latest-value-wins, just like setpoints.
+inline dds::pub::qos::DataWriterQos loadReportWriterQos(const dds::pub::Publisher& publisher)
+{
+    return setpointWriterQos(publisher);
+}
+
+inline dds::sub::qos::DataReaderQos loadReportReaderQos(const dds::sub::Subscriber& subscriber)
+{
+    return setpointReaderQos(subscriber);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/* Include the C++ DDS API. */
+#include "dds/dds.hpp"
+
+
+/*
+ * Readiness of a LedServer/LedClient as one pollable file descriptor, for
+ * embedding them in an application's own epoll/poll/asio loop instead of
+ * running their loops on a thread of their own:
+ *
+ *     int fd = server.eventFd();      // add to the loop, readable == work to do
+ *     ...
+ *     server.pollOnce();              // when fd is readable; never blocks
+ *
+ * fd() is an epoll fd combining an eventfd, signalled by a DDS listener as data
+ * arrives on the watched readers, and a one-shot timerfd for periodic work
+ * (acks, load reports, timeouts). The listeners only write the eventfd; all
+ * the actual work happens in pollOnce(), on the application's thread.
+ */
+class ReadinessFd
+{
+private:
+    struct Watch
+    {
+        virtual ~Watch() = default;
+    };
+
+    template<typename T>
+    class ReaderWatch : public Watch, public dds::sub::NoOpDataReaderListener<T>
+    {
+    private:
+        ReadinessFd& owner;
+        dds::sub::DataReader<T> reader;
+
+    public:
+        ReaderWatch(ReadinessFd& readiness, dds::sub::DataReader<T>& watched)
+            : owner(readiness), reader(watched)
+        {
+            reader.listener(this, dds::core::status::StatusMask::data_available());
+        }
+
+        ~ReaderWatch() override
+        {
+            reader.listener(nullptr, dds::core::status::StatusMask::none());
+        }
+
+        void on_data_available(dds::sub::DataReader<T>&) override
+        {
+            owner.notify();
+        }
+    };
+
+    int epoll_fd{-1};
+    int event_fd{-1};
+    int timer_fd{-1};
+    std::vector<std::unique_ptr<Watch>> watches;
+
+    static void drainFd(int fd)
+    {
+        uint64_t count;
+        while(::read(fd, &count, sizeof(count)) == sizeof(count))
+        {
+            // Non-blocking: stops at EAGAIN
+        }
+    }
+
+    void close()
+    {
+        for (int fd : {timer_fd, event_fd, epoll_fd})
+        {
+            if(fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+public:
+    ReadinessFd()
+    {
+        epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        timer_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        bool ok = epoll_fd >= 0 && event_fd >= 0 && timer_fd >= 0 &&
+                  ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event) == 0 &&
+                  ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) == 0;
+        if(!ok)
+        {
+            std::string error = std::strerror(errno);
+            close();
+            throw std::runtime_error("Readiness fd: " + error);
+        }
+    }
+
+    ~ReadinessFd()
+    {
+        // Detach the listeners before the fds they signal go away
+        watches.clear();
+        close();
+    }
+
+    ReadinessFd(const ReadinessFd&) = delete;
+    ReadinessFd& operator=(const ReadinessFd&) = delete;
+
+    int fd() const
+    {
+        return epoll_fd;
+    }
+
+    // Signal data arrival on 'reader'. Takes over the reader's listener.
+    template<typename T>
+    void watch(dds::sub::DataReader<T>& reader)
+    {
+        watches.push_back(std::make_unique<ReaderWatch<T>>(*this, reader));
+        notify();   // Whatever arrived before the listener was attached
+    }
+
+    // Safe from any thread.
+    void notify()
+    {
+        uint64_t one = 1;
+        (void)::write(event_fd, &one, sizeof(one));
+    }
+
+    // Become readable once 'delay' has passed; 0 disarms. Replaces any earlier setting.
+    void armTimer(std::chrono::microseconds delay)
+    {
+        itimerspec spec{};
+        if(delay.count() > 0)
+        {
+            spec.it_value.tv_sec = static_cast<time_t>(delay.count() / 1000000);
+            spec.it_value.tv_nsec = static_cast<long>(delay.count() % 1000000) * 1000;
+        }
+        ::timerfd_settime(timer_fd, 0, &spec, nullptr);
+    }
+
+    // Reset readiness, before doing the work it announced.
+    void clear()
+    {
+        drainFd(event_fd);
+        drainFd(timer_fd);
+    }
+};
@@ -0,0 +1,971 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <map>
+#include <set>
+#include <deque>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+/* Include the C++ DDS API. */
+#include "dds/dds.hpp"
+#include "dds/dds.h"
+
+#include "LedControl.hpp"
+#include "LedPanels.hpp"
+#include "LedLog.hpp"
+#include "LedQos.hpp"
+#include "LedReadiness.hpp"
+#include "LedTrace.hpp"
+#include "LedProbes.hpp"
+#if LED_ENABLE_COROUTINES
+#include "LedCoroutines.hpp"
+#endif
+#include "LedStartup.hpp"
+
+
+// Requests taken per batch. The sample buffer is allocated once with the server
+// and reused by every take(), rather than loaned afresh for each batch.
+#ifndef LED_REQUEST_POOL_SIZE
+#if LED_LOW_MEMORY
+#define LED_REQUEST_POOL_SIZE 8
+#else
+#define LED_REQUEST_POOL_SIZE 64
+#endif
+#endif
+
+
+class LedServer
+{
+public:
+    // How requests get from the reader to processRequest():
+    //  - WaitSet:  run() waits on a read condition and takes on its own thread
+    //              (one thread handoff from Cyclone's receive thread).
+    //  - Listener: processed in on_data_available(), directly on the thread that
+    //              delivers the data - no handoff, but anything slow in the handler
+    //              stalls reception of everything else.
+    enum class DispatchMode { WaitSet, Listener };
+
+    // Longest a listener callback may block Cyclone's delivery thread per request:
+    // listener dispatch is refused with a longer actuation delay.
+    static constexpr long LISTENER_BUDGET_US = 1000;
+
+private:
+    template<typename T>
+    class DataListener : public dds::sub::NoOpDataReaderListener<T>
+    {
+    private:
+        LedServer& server;
+        void (LedServer::*on_data)();
+
+    public:
+        DataListener(LedServer& owner, void (LedServer::*handler)())
+            : server(owner), on_data(handler) {}
+
+        void on_data_available(dds::sub::DataReader<T>&) override
+        {
+            (server.*on_data)();
+        }
+    };
+
+    dds::domain::DomainParticipant participant;
+    dds::topic::Topic<led_control::LedRequest> request_topic;
+    dds::topic::Topic<led_control::LedResponse> response_topic;
+    dds::sub::Subscriber subscriber;
+    dds::pub::Publisher publisher;
+    dds::sub::Subscriber request_subscriber;    // in the replica's partition, if any
+    dds::sub::Subscriber bulk_subscriber;
+    dds::pub::Publisher bulk_publisher;
+    dds::sub::DataReader<led_control::LedRequest> request_reader;
+    dds::pub::DataWriter<led_control::LedResponse> response_writer;
+    dds::topic::Topic<led_control::LedAck> ack_topic;
+    dds::pub::DataWriter<led_control::LedAck> ack_writer;
+    dds::topic::Topic<led_control::LedSetpoint> setpoint_topic;
+    dds::sub::DataReader<led_control::LedSetpoint> setpoint_reader;
+    dds::topic::Topic<led_control::LedCancel> cancel_topic;
+    dds::sub::DataReader<led_control::LedCancel> cancel_reader;
+    dds::topic::Topic<led_control::LedLoadReport> load_topic;
+    dds::pub::DataWriter<led_control::LedLoadReport> load_writer;
+
+    std::atomic<bool> running{true};
+    DispatchMode dispatch_mode{DispatchMode::WaitSet};
+    DataListener<led_control::LedRequest> request_listener{*this, &LedServer::onRequestsAvailable};
+    DataListener<led_control::LedSetpoint> setpoint_listener{*this, &LedServer::onSetpointsAvailable};
+    bool verbose{true};
+    std::string replica_name;
+    std::unique_ptr<ReadinessFd> readiness;   // set == driven by pollOnce() from the caller's loop
+
+#if LED_ENABLE_COROUTINES
+    // Coroutine handlers: a request suspends while its output is flushed to the
+    // hardware instead of blocking dispatch, and is resumed by the executor,
+    // which runs on the dispatch thread (runWaitSet() or pollOnce()).
+    bool coroutine_handlers{false};
+    led_co::Executor executor;
+    dds::core::cond::GuardCondition executor_wakeup;
+#endif
+
+    // In listener mode the panels' actuation delay blocks the delivering thread,
+    // hence this callback budget.
+    std::chrono::microseconds listener_budget{LISTENER_BUDGET_US};
+
+    // Serializes takes from the pool: in listener mode a callback can race the
+    // initial drain in run().
+    std::mutex dispatch_mutex;
+    std::array<dds::sub::Sample<led_control::LedRequest>, LED_REQUEST_POOL_SIZE> request_pool;
+    std::chrono::steady_clock::time_point last_display{std::chrono::steady_clock::now()};
+
+    // Cumulative ack mode (ack_interval > 0): instead of a LedResponse per request,
+    // each client's progress is tracked here and acked every 'ack_interval'.
+    struct AckProgress
+    {
+        uint32_t up_to_id = 0;
+        std::set<uint32_t> ahead;       // handled, but above a gap (a request not seen yet)
+        std::vector<uint32_t> failed;   // failed since the last ack sent
+        bool dirty = false;
+        std::chrono::steady_clock::time_point last_activity;
+        std::chrono::steady_clock::time_point gap_since;    // when the gap below 'ahead' opened
+    };
+
+    // A gap open this long (or with this many requests handled above it) is
+    // treated as lost, so it can't hold back acks until the client times out.
+    // Its ids are acked as failed: they were never applied.
+    static constexpr std::chrono::milliseconds ACK_GAP_TIMEOUT{1000};
+    static constexpr size_t MAX_ACK_AHEAD = 1024;
+
+    std::chrono::milliseconds ack_interval{0};
+    std::mutex ack_mutex;
+    std::map<uint32_t, AckProgress> ack_progress;
+    std::chrono::steady_clock::time_point last_ack_flush{std::chrono::steady_clock::now()};
+
+    // (client_id, request_id) of cancels whose request has not been seen yet.
+    // Only touched from request dispatch (under 'dispatch_mutex'); the oldest
+    // are forgotten once MAX_CANCELLED are outstanding.
+    static constexpr size_t MAX_CANCELLED = 1024;
+    std::set<std::pair<uint32_t, uint32_t>> cancelled;
+    std::deque<std::pair<uint32_t, uint32_t>> cancelled_order;
+
+    // Load reporting and shedding. A request that has waited longer than
+    // 'shed_after' since it was taken from the reader is answered without being
+    // actuated: its client has probably given up already, and working it off
+    // would only make the queue longer. Measured on the server's own steady
+    // clock, so the client's clock doesn't matter.
+    std::chrono::milliseconds load_report_interval{500};
+    std::chrono::milliseconds shed_after{0};    // 0 == never shed
+    std::chrono::steady_clock::time_point last_load_report{std::chrono::steady_clock::now()};
+
+    // Startup phases still being timed; completed by the first response sent.
+    StartupTimer* startup_timer{nullptr};
+
+    // Application-side counters, read by the stats collector from another thread.
+    std::atomic<unsigned long> requests_processed{0};
+    std::atomic<unsigned long> last_batch_size{0};
+    std::atomic<unsigned long> max_batch_size{0};
+    std::atomic<unsigned long> slow_callbacks{0};
+    std::atomic<unsigned long> setpoints_applied{0};
+    std::atomic<unsigned long> requests_cancelled{0};
+    std::atomic<unsigned long> requests_shed{0};
+    std::atomic<unsigned long> service_time_us{0};    // moving average, see processRequest()
+    std::atomic<unsigned long> requests_in_flight{0}; // suspended coroutine handlers
+
+    // The simulated panels all requests and setpoints are applied to
+    LedPanels panels;
+
+    const char* opToString(const led_control::LedRequest& request)
+    {
+        switch(request.op()) {
+            case led_control::LedOp::TOGGLE: return "TOGGLE";
+            case led_control::LedOp::STORE_SCENE: return "STORE SCENE";
+            case led_control::LedOp::RECALL_SCENE: return "RECALL SCENE";
+            case led_control::LedOp::SET_IF_VERSION: return request.state() ? "ON (if version)" : "OFF (if version)";
+            default: return request.state() ? "ON" : "OFF";
+        }
+    }
+
+    void processRequest(const led_control::LedRequest& request, std::chrono::steady_clock::time_point taken_at)
+    {
+        LED_PROBE4(request_receive, request.client_id(), request.request_id(), request.panel_id(),
+                   static_cast<int>(request.op()));
+
+        if(verbose)
+        {
+            if(request.transaction().empty())
+            {
+                led_log::out << "Received request: "
+                          << LedPanels::colorToString(request.color())
+                          << " -> " << opToString(request)
+                          << " (ID: " << request.request_id() << ")" << led_log::endl;
+            }
+            else
+            {
+                led_log::out << "Received transaction of " << request.transaction().size()
+                          << " commands (ID: " << request.request_id() << ")" << led_log::endl;
+            }
+        }
+
+        // Last chance to withdraw it: nothing has been actuated yet
+        takeCancels();
+        led_control::LedResponse response;
+        if(isCancelled(request))
+        {
+            response = rejectedResponse(request, "Cancelled");
+            ++requests_cancelled;
+        }
+        else if(isStale(taken_at))
+        {
+            response = rejectedResponse(request, "Shed: server overloaded");
+            ++requests_shed;
+        }
+#if LED_ENABLE_COROUTINES
+        else if(coroutine_handlers)
+        {
+            serveAsync(request);
+            return;
+        }
+#endif
+        else
+        {
+            auto start = std::chrono::steady_clock::now();
+            response = panels.handleRequest(request);
+            recordServiceTime(start);
+        }
+
+        finishRequest(request, response);
+    }
+
+#if LED_ENABLE_COROUTINES
+    // processRequest() for coroutine handlers. Takes its own copy of the request:
+    // the pool sample it came from is reused while this is suspended.
+    led_co::Task serveAsync(led_control::LedRequest request)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // Applied right away, so requests still take effect in the order taken
+        led_control::LedResponse response = panels.applyRequest(request);
+
+        // Simulated hardware flush: other requests are served in the meantime
+        if(response.success() && panels.actuationDelay().count() > 0)
+        {
+            auto flush_start = led_trace::Clock::now();
+            LED_PROBE2(actuation_start, request.client_id(), request.request_id());
+            ++requests_in_flight;
+            co_await led_co::sleepFor(executor, panels.actuationDelay());
+            --requests_in_flight;
+            LED_PROBE2(actuation_end, request.client_id(), request.request_id());
+            led_trace::Tracer::instance().record("server.actuation",
+                led_trace::traceId(request.client_id(), request.request_id()), flush_start, led_trace::Clock::now());
+        }
+
+        recordServiceTime(start);
+        finishRequest(request, response);
+    }
+#endif
+
+    // Exponential moving average over roughly the last 8 requests. Called from
+    // whichever thread finishes a request - Cyclone's delivery threads in
+    // listener mode, the executor for coroutine handlers - so it is updated
+    // with a compare-and-swap loop rather than a load and a store.
+    void recordServiceTime(std::chrono::steady_clock::time_point start)
+    {
+        auto took = static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        unsigned long average = service_time_us.load();
+        while(!service_time_us.compare_exchange_weak(average, (average * 7 + took) / 8))
+        {
+        }
+    }
+
+    // Ack or answer a request that has been dealt with
+    void finishRequest(const led_control::LedRequest& request, const led_control::LedResponse& response)
+    {
+        led_trace::Span span("server.respond", led_trace::traceId(request.client_id(), request.request_id()));
+
+        if(ack_interval.count() > 0)
+        {
+            recordAck(request.client_id(), request.request_id(), response.success());
+            LED_PROBE3(ack_record, request.client_id(), request.request_id(), response.success() ? 1 : 0);
+            return;
+        }
+
+        // Send response, then unregister its instance so readers can reclaim it
+        auto handle = response_writer.register_instance(response);
+        response_writer.write(response, handle);
+        response_writer.unregister_instance(handle);
+        LED_PROBE3(response_write, response.client_id(), response.request_id(), response.success() ? 1 : 0);
+        responseSent();
+
+        if(verbose)
+        {
+            led_log::out << "Sent response for request ID: "
+                      << request.request_id() << led_log::endl;
+        }
+    }
+
+    void takeCancels()
+    {
+        auto samples = cancel_reader.select()
+            .state(unreadData())
+            .take();
+
+        for (const auto& sample : samples)
+        {
+            if(sample.info().valid())
+            {
+                auto key = std::make_pair(sample.data().client_id(), sample.data().request_id());
+                if(cancelled.insert(key).second)
+                {
+                    cancelled_order.push_back(key);
+                }
+            }
+        }
+
+        while(cancelled_order.size() > MAX_CANCELLED)
+        {
+            cancelled.erase(cancelled_order.front());
+            cancelled_order.pop_front();
+        }
+    }
+
+    bool isCancelled(const led_control::LedRequest& request)
+    {
+        if(cancelled.empty())
+        {
+            return false;
+        }
+        // Stale 'cancelled_order' entries are harmless: ids are not reused
+        return cancelled.erase(std::make_pair(request.client_id(), request.request_id())) > 0;
+    }
+
+    // A lower bound on the time spent queued in this server: samples taken in
+    // the same batch wait for each other's actuation. Time in the reader before
+    // the take isn't counted, there is no reception timestamp to go by.
+    bool isStale(std::chrono::steady_clock::time_point taken_at) const
+    {
+        if(shed_after.count() == 0)
+        {
+            return false;
+        }
+        return std::chrono::steady_clock::now() - taken_at > shed_after;
+    }
+
+    // Answer without actuating anything
+    led_control::LedResponse rejectedResponse(const led_control::LedRequest& request, const char* reason)
+    {
+        led_control::LedResponse response;
+        response.request_id(request.request_id());
+        response.client_id(request.client_id());
+        response.panel_id(request.panel_id());
+        response.color(request.color());
+        response.success(false);
+        response.message(reason);
+
+        if(verbose)
+        {
+            led_log::out << "Request ID " << request.request_id() << ": " << reason << led_log::endl;
+        }
+        return response;
+    }
+
+    void publishLoadPeriodically()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if(load_report_interval.count() == 0 || now - last_load_report < load_report_interval)
+        {
+            return;
+        }
+        last_load_report = now;
+
+        led_control::LedLoadReport report;
+        report.replica(replica_name);
+        report.queue_depth(static_cast<uint32_t>(last_batch_size.load()));
+        report.service_time_us(static_cast<uint32_t>(service_time_us.load()));
+        report.shed_count(static_cast<uint32_t>(requests_shed.load()));
+        load_writer.write(report);
+    }
+
+    void responseSent()
+    {
+        if(startup_timer)
+        {
+            startup_timer->mark("first response");
+            startup_timer->report("led_server");
+            startup_timer = nullptr;
+        }
+    }
+
+    void recordAck(uint32_t client_id, uint32_t request_id, bool success)
+    {
+        std::lock_guard<std::mutex> lock(ack_mutex);
+
+        auto inserted = ack_progress.try_emplace(client_id);
+        AckProgress& progress = inserted.first->second;
+        if(inserted.second)
+        {
+            // First request seen from this client (it may predate a server restart)
+            progress.up_to_id = request_id - 1;
+        }
+        progress.last_activity = std::chrono::steady_clock::now();
+        progress.dirty = true;
+
+        if(!success)
+        {
+            progress.failed.push_back(request_id);
+        }
+        if(request_id <= progress.up_to_id)
+        {
+            return;
+        }
+
+        if(progress.ahead.empty())
+        {
+            progress.gap_since = progress.last_activity;
+        }
+        progress.ahead.insert(request_id);
+        advanceAcks(progress);
+        if(progress.ahead.size() > MAX_ACK_AHEAD)
+        {
+            skipAckGap(progress);
+        }
+    }
+
+    // Move 'up_to_id' over requests handled in sequence. Caller holds ack_mutex.
+    static void advanceAcks(AckProgress& progress)
+    {
+        uint32_t before = progress.up_to_id;
+        while(!progress.ahead.empty() && *progress.ahead.begin() == progress.up_to_id + 1)
+        {
+            ++progress.up_to_id;
+            progress.ahead.erase(progress.ahead.begin());
+        }
+        if(progress.up_to_id != before)
+        {
+            // The next gap up, if there is one, only counts from now
+            progress.gap_since = std::chrono::steady_clock::now();
+        }
+    }
+
+    // Give up on the lowest gap: its requests never arrived, so they are acked
+    // as failed rather than folded into 'up_to_id' as applied. (One that turns
+    // up after all is still applied, like a request whose client timed out.)
+    // Caller holds ack_mutex.
+    static void skipAckGap(AckProgress& progress)
+    {
+        for (uint32_t id = progress.up_to_id + 1; id != *progress.ahead.begin(); ++id)
+        {
+            progress.failed.push_back(id);
+        }
+        progress.up_to_id = *progress.ahead.begin() - 1;
+        progress.dirty = true;
+        advanceAcks(progress);
+    }
+
+    // Send one ack per client with progress since the last flush, once per
+    // 'ack_interval'. Clients idle for a minute are forgotten.
+    void flushAcks()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if(ack_interval.count() == 0 || now - last_ack_flush < ack_interval)
+        {
+            return;
+        }
+        last_ack_flush = now;
+
+        std::lock_guard<std::mutex> lock(ack_mutex);
+
+        for (auto it = ack_progress.begin(); it != ack_progress.end(); )
+        {
+            AckProgress& progress = it->second;
+
+            if(!progress.ahead.empty() && now - progress.gap_since > ACK_GAP_TIMEOUT)
+            {
+                skipAckGap(progress);
+            }
+
+            led_control::LedAck ack;
+            ack.client_id(it->first);
+            ack.up_to_id(progress.up_to_id);
+
+            if(progress.dirty)
+            {
+                ack.failed_ids(progress.failed);
+                ack_writer.write(ack);
+                responseSent();
+
+                progress.failed.clear();
+                progress.dirty = false;
+            }
+            else if(now - progress.last_activity > std::chrono::minutes(1))
+            {
+                ack_writer.unregister_instance(ack_writer.register_instance(ack));
+                it = ack_progress.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    std::chrono::milliseconds idleWait(std::chrono::milliseconds wait) const
+    {
+        if(ack_interval.count() > 0)
+        {
+            wait = std::min(wait, ack_interval);
+        }
+        if(load_report_interval.count() > 0)
+        {
+            wait = std::min(wait, load_report_interval);
+        }
+        return wait;
+    }
+
+    // idleWait(), but also waking up for the next coroutine handler timer.
+    std::chrono::milliseconds nextWait(std::chrono::milliseconds wait)
+    {
+        wait = idleWait(wait);
+#if LED_ENABLE_COROUTINES
+        wait = executor.untilNextTimer(wait);
+#endif
+        return wait;
+    }
+
+    // Take and process everything currently in the reader, one pool-sized batch
+    // at a time.
+    void drainRequests()
+    {
+        std::lock_guard<std::mutex> lock(dispatch_mutex);
+
+        unsigned long batch;
+        unsigned long taken = 0;
+        do
+        {
+            auto take_start = led_trace::Clock::now();
+            batch = request_reader.select()
+                .state(unreadData())
+                .take(request_pool.begin(), static_cast<uint32_t>(request_pool.size()));
+            auto take_end = led_trace::Clock::now();
+
+            taken += batch;
+
+            for (unsigned long n = 0; n < batch; ++n)
+            {
+                const auto& sample = request_pool[n];
+                if(sample.info().valid())
+                {
+                    uint64_t trace_id = led_trace::traceId(sample.data().client_id(), sample.data().request_id());
+                    led_trace::recordSince("server.queue", trace_id, toSystemClock(sample.info().timestamp()));
+                    led_trace::Tracer::instance().record("server.take", trace_id, take_start, take_end);
+
+                    processRequest(sample.data(), take_end);
+                    ++requests_processed;
+                }
+            }
+        }
+        while(batch == request_pool.size());
+
+        // Samples taken in one pass == requests that queued up in the reader while
+        // the previous pass was being processed, however many pool-sized takes
+        // it took. This is the queue depth load reports carry.
+        last_batch_size = taken;
+        if(taken > max_batch_size)
+        {
+            max_batch_size = taken;
+        }
+    }
+
+    // Listener mode: runs on the thread delivering the data. All samples must be
+    // taken here - on_data_available only fires again for new arrivals.
+    void onRequestsAvailable()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        try
+        {
+            drainRequests();
+        }
+        catch(const dds::core::Exception& e)
+        {
+            // Never let an exception escape into Cyclone's thread
+            led_log::err << "DDS Exception in listener: " << e.what() << led_log::endl;
+        }
+
+        if(std::chrono::steady_clock::now() - start > listener_budget &&
+           slow_callbacks++ == 0)
+        {
+            led_log::err << "Warning: request handling exceeded the listener budget of "
+                         << static_cast<long>(listener_budget.count()) << " us - "
+                         << "this delays all other data delivered on the same thread" << led_log::endl;
+        }
+    }
+
+    // Streaming setpoints: apply whatever is newest per LED, no reply. Cheap enough
+    // to run on the delivering thread in listener mode (no actuation delay).
+    void applySetpoints()
+    {
+        auto samples = setpoint_reader.select()
+            .state(unreadData())
+            .take();
+
+        for (const auto& sample : samples)
+        {
+            // Setpoints for panels hosted elsewhere are ignored
+            if(sample.info().valid() && panels.applySetpoint(sample.data()))
+            {
+                ++setpoints_applied;
+            }
+        }
+    }
+
+    void onSetpointsAvailable()
+    {
+        try
+        {
+            applySetpoints();
+        }
+        catch(const dds::core::Exception& e)
+        {
+            led_log::err << "DDS Exception in listener: " << e.what() << led_log::endl;
+        }
+    }
+
+    void displayPeriodically()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if(now - last_display > std::chrono::seconds(5)) {
+            panels.display();
+            last_display = now;
+        }
+    }
+
+    void runWaitSet()
+    {
+        dds::sub::cond::ReadCondition read_cond(
+            request_reader,
+            dds::sub::status::DataState::any());
+
+        dds::sub::cond::ReadCondition setpoint_cond(
+            setpoint_reader,
+            dds::sub::status::DataState::any());
+
+        dds::core::cond::WaitSet  waitset;
+        waitset += read_cond;
+        waitset += setpoint_cond;
+
+#if LED_ENABLE_COROUTINES
+        // Completions posted from other threads must interrupt the wait
+        waitset += executor_wakeup;
+        executor.setWakeup([this]() { executor_wakeup.trigger_value(true); });
+#endif
+
+        while (running)
+        {
+            try {
+#if LED_ENABLE_COROUTINES
+                executor_wakeup.trigger_value(false);
+                executor.runDue();
+#endif
+                applySetpoints();
+                drainRequests();
+
+                // Periodically show current state and send cumulative acks
+                displayPeriodically();
+                flushAcks();
+                publishLoadPeriodically();
+
+                // Wait for next request with timeout
+                waitset.wait(dds::core::Duration::from_millisecs(
+                    nextWait(std::chrono::seconds(1)).count()));
+            }
+            catch(const dds::core::TimeoutError&)
+            {
+                // Periodic wake-up for acks, load reports and timers
+            }
+            catch(const dds::core::Exception& e)
+            {
+                led_log::err << "DDS Exception: " << e.what() << led_log::endl;
+            }
+        }
+    }
+
+    void runListener()
+    {
+        request_reader.listener(&request_listener, dds::core::status::StatusMask::data_available());
+        setpoint_reader.listener(&setpoint_listener, dds::core::status::StatusMask::data_available());
+
+        try
+        {
+            // Whatever arrived before the listeners were attached
+            applySetpoints();
+            drainRequests();
+        }
+        catch(const dds::core::Exception& e)
+        {
+            led_log::err << "DDS Exception: " << e.what() << led_log::endl;
+        }
+
+        while (running)
+        {
+            displayPeriodically();
+            try
+            {
+                flushAcks();
+                publishLoadPeriodically();
+            }
+            catch(const dds::core::Exception& e)
+            {
+                led_log::err << "DDS Exception: " << e.what() << led_log::endl;
+            }
+            std::this_thread::sleep_for(idleWait(std::chrono::milliseconds(100)));
+        }
+
+        // No callbacks may run once we return (or the server is destroyed)
+        request_reader.listener(nullptr, dds::core::status::StatusMask::none());
+        setpoint_reader.listener(nullptr, dds::core::status::StatusMask::none());
+    }
+
+    void checkListenerBudget(DispatchMode mode, std::chrono::microseconds delay) const
+    {
+        if(mode == DispatchMode::Listener && delay > listener_budget)
+        {
+            throw std::invalid_argument("listener dispatch needs an actuation delay of at most " +
+                                        std::to_string(listener_budget.count()) + " us, not " +
+                                        std::to_string(delay.count()) + " us: it would block Cyclone's delivery thread");
+        }
+    }
+
+public:
+    LedServer(int domain_id = 0, const LedQosConfig& qos = LedQosConfig(), const std::string& replica = "")
+        : LedServer(dds::domain::DomainParticipant(domain_id), qos, replica) {}
+
+    // Attach to an existing participant, e.g. one shared with an in-process
+    // LedClient - Cyclone then delivers between the two without touching the network.
+    // A non-empty 'replica' name makes this server one of several redundant ones:
+    // it then only takes requests sent to that replica (see LedClient hedging).
+    explicit LedServer(const dds::domain::DomainParticipant& shared_participant,
+                       const LedQosConfig& qos = LedQosConfig(),
+                       const std::string& replica = "")
+        : participant(shared_participant),
+          request_topic(participant, "led_control_requests"),
+          response_topic(participant, "led_control_responses"),
+          subscriber(participant),
+          publisher(participant),
+          request_subscriber(replica.empty() ? subscriber : partitionSubscriber(participant, replica)),
+          bulk_subscriber(bulkSubscriber(participant)),
+          bulk_publisher(bulkPublisher(participant)),
+          request_reader(request_subscriber, request_topic, qos.readerQos(request_subscriber)),
+          response_writer(publisher, response_topic, qos.writerQos(publisher)),
+          ack_topic(participant, "led_control_acks"),
+          ack_writer(publisher, ack_topic, ackWriterQos(publisher)),
+          setpoint_topic(participant, "led_control_setpoints"),
+          setpoint_reader(bulk_subscriber, setpoint_topic, setpointReaderQos(bulk_subscriber)),
+          cancel_topic(participant, "led_control_cancels"),
+          cancel_reader(subscriber, cancel_topic, cancelReaderQos(subscriber)),
+          load_topic(participant, "led_control_load"),
+          load_writer(bulk_publisher, load_topic, loadReportWriterQos(bulk_publisher)),
+          replica_name(replica) {
+
+        led_log::out << "LED Control Server started" << led_log::endl;
+        led_log::out << "Listening for requests on topic: led_control_requests";
+        if(!replica.empty())
+        {
+            led_log::out << " (replica " << replica << ")";
+        }
+        led_log::out << led_log::endl;
+        led_log::out << "Sending responses on topic: led_control_responses" << led_log::endl;
+        led_log::out << "Applying setpoints from topic: led_control_setpoints" << led_log::endl;
+    }
+
+    // Block until 'clients' clients are matched on both the request reader and the
+    // response writer (a request from a client whose response reader we have not
+    // yet discovered would have its response dropped). Returns false on timeout.
+    bool waitForClients(int32_t clients, std::chrono::milliseconds timeout)
+    {
+        dds::core::cond::StatusCondition reader_matched(request_reader);
+        reader_matched.enabled_statuses(dds::core::status::StatusMask::subscription_matched());
+        dds::core::cond::StatusCondition writer_matched(response_writer);
+        writer_matched.enabled_statuses(dds::core::status::StatusMask::publication_matched());
+
+        dds::core::cond::WaitSet waitset;
+        waitset += reader_matched;
+        waitset += writer_matched;
+
+        return waitForMatch(waitset, [this, clients]()
+        {
+            return request_reader.subscription_matched_status().current_count() >= clients &&
+                   response_writer.publication_matched_status().current_count() >= clients;
+        }, timeout);
+    }
+
+    // Report startup phases through 'timer' once the first response has been sent.
+    // Must be set before run() is started.
+    void setStartupTimer(StartupTimer* timer)
+    {
+        startup_timer = timer;
+    }
+
+    // Must be set before run() is started, after setActuationDelay(). Listener
+    // dispatch is refused if a single request's actuation would already exceed
+    // the callback budget.
+    void setDispatchMode(DispatchMode mode)
+    {
+        checkListenerBudget(mode, panels.actuationDelay());
+        dispatch_mode = mode;
+    }
+
+    // Acknowledge requests cumulatively every 'interval' instead of sending a
+    // LedResponse each (0 = per-request responses). Must be set before run() is started.
+    void setAckInterval(std::chrono::milliseconds interval)
+    {
+        ack_interval = interval;
+    }
+
+    // Simulated per-request actuation time. Must be set before run() is started.
+    void setActuationDelay(std::chrono::microseconds delay)
+    {
+        checkListenerBudget(dispatch_mode, delay);
+        panels.setActuationDelay(delay);
+    }
+
+    // Publish a LedLoadReport every 'interval' (0 disables). Must be set before run() is started.
+    void setLoadReportInterval(std::chrono::milliseconds interval)
+    {
+        load_report_interval = interval;
+    }
+
+    // Answer requests that waited longer than 'age' after being taken, without
+    // actuating them (0 disables). Must be set before run() is started.
+    void setShedAfter(std::chrono::milliseconds age)
+    {
+        shed_after = age;
+    }
+
+    // Host 'count' independent panels, addressed by LedRequest/LedSetpoint panel_id
+    // 0 .. count-1, all on this one participant. Must be set before run() is started.
+    void setPanelCount(size_t count)
+    {
+        panels.resize(count);
+    }
+
+    // Per-request console output. Must be set before run() is started.
+    void setVerbose(bool on)
+    {
+        verbose = on;
+    }
+
+#if LED_ENABLE_COROUTINES
+    // Serve requests with coroutine handlers (see serveAsync()), so requests
+    // waiting for the hardware don't hold up the others. Needs WaitSet dispatch
+    // or pollOnce(): the executor runs on that thread. Set before run().
+    void setCoroutineHandlers(bool on)
+    {
+        coroutine_handlers = on;
+    }
+#endif
+
+    // Apply a request to the (simulated) hardware and build its response,
+    // without going through DDS. Thread-safe.
+    led_control::LedResponse handleRequest(const led_control::LedRequest& request)
+    {
+        return panels.handleRequest(request);
+    }
+
+    void run()
+    {
+        if(dispatch_mode == DispatchMode::Listener)
+        {
+            runListener();
+        }
+        else
+        {
+            runWaitSet();
+        }
+    }
+
+    void stop()
+    {
+        running = false;
+    }
+
+    // Instead of run(): a descriptor that polls readable whenever pollOnce() has
+    // work to do - requests or setpoints arrived, or acks/load reports are due.
+    // Takes over the readers' listeners, so not to be mixed with run().
+    int eventFd()
+    {
+        if(!readiness)
+        {
+            readiness = std::make_unique<ReadinessFd>();
+            readiness->watch(request_reader);
+            readiness->watch(setpoint_reader);
+#if LED_ENABLE_COROUTINES
+            executor.setWakeup([this]() { readiness->notify(); });
+#endif
+        }
+        return readiness->fd();
+    }
+
+    // Do whatever work is pending, without blocking, and re-arm eventFd()'s timer
+    // for the next periodic work.
+    void pollOnce()
+    {
+        if(readiness)
+        {
+            readiness->clear();
+        }
+
+#if LED_ENABLE_COROUTINES
+        executor.runDue();
+#endif
+        applySetpoints();
+        drainRequests();
+        displayPeriodically();
+        flushAcks();
+        publishLoadPeriodically();
+
+        if(readiness)
+        {
+            // A timer that is already due must still fire: never arm 0 (== disarm)
+            readiness->armTimer(std::max(std::chrono::microseconds(1),
+                                         std::chrono::microseconds(nextWait(std::chrono::seconds(1)))));
+        }
+    }
+
+    // Snapshot of DDS status counters plus application queue depths, as JSON.
+    // Safe to call from any thread (e.g. a StatsEndpoint).
+    std::string statsJson()
+    {
+        auto lost = request_reader.sample_lost_status();
+        auto rejected = request_reader.sample_rejected_status();
+        auto deadline = request_reader.requested_deadline_missed_status();
+        auto readers_matched = request_reader.subscription_matched_status();
+        auto writers_matched = response_writer.publication_matched_status();
+        auto offered_deadline = response_writer.offered_deadline_missed_status();
+        WriterRetransmits retransmits = writerRetransmits(response_writer->get_ddsc_entity());
+
+        char buf[704];
+        std::snprintf(buf, sizeof(buf),
+            "{\"request_reader\":{\"matched\":%d,\"sample_lost\":%d,\"sample_rejected\":%d,"
+            "\"deadline_missed\":%d},"
+            "\"response_writer\":{\"matched\":%d,\"deadline_missed\":%d,\"rexmit_bytes\":%llu,"
+            "\"throttle_count\":%lu},"
+            "\"app\":{\"requests_processed\":%lu,\"last_batch\":%lu,\"max_batch\":%lu,"
+            "\"slow_callbacks\":%lu,\"setpoints_applied\":%lu,\"cancelled\":%lu,\"shed\":%lu,"
+            "\"service_time_us\":%lu,\"in_flight\":%lu,\"panels\":%lu}}\n",
+            readers_matched.current_count(), lost.total_count(), rejected.total_count(),
+            deadline.total_count(),
+            writers_matched.current_count(), offered_deadline.total_count(),
+            retransmits.rexmit_bytes, retransmits.throttle_count,
+            requests_processed.load(), last_batch_size.load(), max_batch_size.load(),
+            slow_callbacks.load(), setpoints_applied.load(), requests_cancelled.load(), requests_shed.load(),
+            service_time_us.load(), requests_in_flight.load(), static_cast<unsigned long>(panels.size()));
+
+        return buf;
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <utility>
+
+/* Include the C++ DDS API. */
+#include "dds/dds.hpp"
+
+#include "LedLog.hpp"
+
+
+// Records the duration of each startup phase (participant, entities, discovery,
+// first response, ...) and logs them as one line. Not thread-safe: mark phases
+// from one thread at a time.
+class StartupTimer
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start{Clock::now()};
+    Clock::time_point last{start};
+    std::vector<std::pair<const char*, Clock::duration>> phases;
+
+    static double toMs(Clock::duration d)
+    {
+        return std::round(std::chrono::duration<double, std::milli>(d).count() * 10.0) / 10.0;
+    }
+
+public:
+    void mark(const char* phase)
+    {
+        auto now = Clock::now();
+        phases.emplace_back(phase, now - last);
+        last = now;
+    }
+
+    void report(const char* who) const
+    {
+        led_log::out << "Startup (" << who << "):";
+        for (const auto& phase : phases)
+        {
+            led_log::out << " " << phase.first << " " << toMs(phase.second) << " ms,";
+        }
+        led_log::out << " total " << toMs(last - start) << " ms" << led_log::endl;
+    }
+};
+
+
+// Block until 'matched()' holds or 'timeout' expires, waking up on matched-status
+// changes of the conditions in 'waitset' instead of polling. Returns 'matched()'.
+template<typename Matched>
+bool waitForMatch(dds::core::cond::WaitSet& waitset, Matched matched, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while(!matched())
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if(left.count() <= 0)
+        {
+            return false;
+        }
+
+        try
+        {
+            waitset.wait(dds::core::Duration::from_millisecs(left.count()));
+        }
+        catch(const dds::core::TimeoutError&)
+        {
+            // Deadline handled above
+        }
+    }
+
+    return true;
+}
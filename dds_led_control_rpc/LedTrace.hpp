@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+
+/*
+ * Request lifecycle tracing: one span per stage a request goes through (client
+ * send, server queue wait, take, actuation, response write, client receive),
+ * exported as Chrome trace-event JSON - open it in https://ui.perfetto.dev or
+ * chrome://tracing.
+ *
+ *     led_trace::Tracer::instance().enable(100);    // trace 1 request in 100
+ *     ...
+ *     led_trace::Span span("server.actuation", led_trace::traceId(client, request));
+ *     ...
+ *     led_trace::Tracer::instance().writeChromeJson("server.json", "led_server");
+ *
+ * Sampling is head-based and needs no coordination: whether a request is traced
+ * is a hash of its (client_id, request_id), so client and server pick the same
+ * requests. Spans are appended to a fixed-size buffer per thread - no locks, no
+ * allocation - and dropped once it is full. Disabled or unsampled, a span costs
+ * one relaxed load and a multiply.
+ *
+ * Timestamps are CLOCK_MONOTONIC, which all processes on a host share: the
+ * client's and server's files can be merged into one timeline with
+ *
+ *     jq -s '{traceEvents: map(.traceEvents[])}' client.json server.json > all.json
+ */
+
+#ifndef LED_TRACE_BUFFER_EVENTS
+#if LED_LOW_MEMORY
+#define LED_TRACE_BUFFER_EVENTS 4096
+#else
+#define LED_TRACE_BUFFER_EVENTS 65536
+#endif
+#endif
+
+
+namespace led_trace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// The id shared by all spans of one request.
+inline uint64_t traceId(uint32_t client_id, uint32_t request_id)
+{
+    return (static_cast<uint64_t>(client_id) << 32) | request_id;
+}
+
+
+class Tracer
+{
+private:
+    struct Event
+    {
+        const char* name;   // string literal
+        uint64_t id;
+        Clock::time_point start;
+        Clock::time_point end;
+    };
+
+    // Written by its own thread only. 'count' is published with release order,
+    // so the exporter can read everything below it while tracing goes on.
+    struct Buffer
+    {
+        uint32_t tid;
+        std::vector<Event> events;
+        std::atomic<size_t> count{0};
+        std::atomic<unsigned long> dropped{0};
+
+        explicit Buffer(uint32_t thread_index)
+            : tid(thread_index), events(LED_TRACE_BUFFER_EVENTS) {}
+    };
+
+    std::atomic<bool> on{false};
+    uint64_t sample_every{1};
+
+    std::mutex buffers_mutex;   // only taken the first time a thread records
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    Buffer& local()
+    {
+        thread_local Buffer* buffer = nullptr;
+        if(!buffer)
+        {
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            buffers.push_back(std::make_unique<Buffer>(static_cast<uint32_t>(buffers.size() + 1)));
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    Tracer() = default;
+
+public:
+    static Tracer& instance()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // Trace one request in 'one_in' (1 == all). Call before any traffic flows.
+    void enable(uint32_t one_in)
+    {
+        sample_every = one_in > 0 ? one_in : 1;
+        on.store(true, std::memory_order_relaxed);
+    }
+
+    bool sampled(uint64_t id) const
+    {
+        if(!on.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        // Fibonacci hashing: consecutive request ids spread evenly
+        return ((id * 0x9E3779B97F4A7C15ull) >> 32) % sample_every == 0;
+    }
+
+    // Record a finished span, if its request is sampled.
+    void record(const char* name, uint64_t id, Clock::time_point start, Clock::time_point end)
+    {
+        if(!sampled(id))
+        {
+            return;
+        }
+
+        Buffer& buffer = local();
+        size_t n = buffer.count.load(std::memory_order_relaxed);
+        if(n == buffer.events.size())
+        {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[n] = Event{name, id, start, end};
+        buffer.count.store(n + 1, std::memory_order_release);
+    }
+
+    // Everything recorded so far, as Chrome trace-event JSON. Returns false if
+    // the file can't be written.
+    bool writeChromeJson(const char* path, const char* process_name)
+    {
+        std::FILE* file = std::fopen(path, "w");
+        if(!file)
+        {
+            return false;
+        }
+
+        long pid = static_cast<long>(::getpid());
+        unsigned long dropped = 0;
+        std::fprintf(file, "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,"
+                           "\"args\":{\"name\":\"%s\"}}", pid, process_name);
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        for (const auto& buffer : buffers)
+        {
+            size_t count = buffer->count.load(std::memory_order_acquire);
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Event& event = buffer->events[i];
+                auto start_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    event.start.time_since_epoch()).count();
+                auto dur_us = std::chrono::duration_cast<std::chrono::microseconds>(event.end - event.start).count();
+                std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"led\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                                   "\"pid\":%ld,\"tid\":%u,\"args\":{\"client\":%u,\"request\":%u}}",
+                             event.name, static_cast<long long>(start_us), static_cast<long long>(dur_us),
+                             pid, buffer->tid,
+                             static_cast<unsigned>(event.id >> 32), static_cast<unsigned>(event.id & 0xffffffffu));
+            }
+        }
+        std::fprintf(file, "\n],\"otherData\":{\"dropped_spans\":%lu,\"sample_one_in\":%llu}}\n",
+                     dropped, static_cast<unsigned long long>(sample_every));
+
+        return std::fclose(file) == 0;
+    }
+};
+
+
+// Times the enclosing scope as one span of request 'id'.
+class Span
+{
+private:
+    const char* name;
+    uint64_t id;
+    bool active;
+    Clock::time_point start;
+
+public:
+    Span(const char* span_name, uint64_t trace_id)
+        : name(span_name), id(trace_id), active(Tracer::instance().sampled(trace_id))
+    {
+        if(active)
+        {
+            start = Clock::now();
+        }
+    }
+
+    ~Span()
+    {
+        if(active)
+        {
+            Tracer::instance().record(name, id, start, Clock::now());
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+};
+
+
+// A span that started before we got to see it: from 'sent', on the sender's
+// clock, until now - e.g. queue wait from a DDS source timestamp. Only
+// meaningful with synchronized clocks (trivially so on one host).
+inline void recordSince(const char* name, uint64_t id, std::chrono::system_clock::time_point sent)
+{
+    Tracer& tracer = Tracer::instance();
+    if(tracer.sampled(id))
+    {
+        auto now = Clock::now();
+        auto age = std::chrono::system_clock::now() - sent;
+        tracer.record(name, id, now - std::chrono::duration_cast<Clock::duration>(age), now);
+    }
+}
+
+}
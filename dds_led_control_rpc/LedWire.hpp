@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <arpa/inet.h>
+
+#include "LedControl.hpp"
+
+
+/*
+ * Fixed-size wire format for the raw-socket baseline (led_raw_server and
+ * led_bench --transport udp|unix): the plain single-LED LedRequest/LedResponse
+ * exchange, one datagram each, integers in network byte order. No
+ * transactions, scenes or response messages - just enough to measure what the
+ * exchange costs without DDS.
+ */
+
+namespace led_wire
+{
+
+#pragma pack(push, 1)
+
+struct Request
+{
+    uint32_t client_id;
+    uint32_t request_id;
+    uint32_t panel_id;
+    uint32_t expected_version;
+    uint8_t color;
+    uint8_t op;
+    uint8_t state;
+    uint8_t reserved;
+};
+
+struct Response
+{
+    uint32_t client_id;
+    uint32_t request_id;
+    uint32_t panel_id;
+    uint32_t version;
+    uint8_t color;
+    uint8_t state;
+    uint8_t success;
+    uint8_t reserved;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(Request) == 20, "wire request layout");
+static_assert(sizeof(Response) == 20, "wire response layout");
+
+
+inline Request toWire(const led_control::LedRequest& request)
+{
+    Request wire{};
+    wire.client_id = htonl(request.client_id());
+    wire.request_id = htonl(request.request_id());
+    wire.panel_id = htonl(request.panel_id());
+    wire.expected_version = htonl(request.expected_version());
+    wire.color = static_cast<uint8_t>(request.color());
+    wire.op = static_cast<uint8_t>(request.op());
+    wire.state = request.state() ? 1 : 0;
+    return wire;
+}
+
+inline led_control::LedRequest fromWire(const Request& wire)
+{
+    led_control::LedRequest request;
+    request.client_id(ntohl(wire.client_id));
+    request.request_id(ntohl(wire.request_id));
+    request.panel_id(ntohl(wire.panel_id));
+    request.expected_version(ntohl(wire.expected_version));
+    request.color(static_cast<led_control::LedColor>(wire.color));
+    request.op(static_cast<led_control::LedOp>(wire.op));
+    request.state(wire.state != 0);
+    return request;
+}
+
+inline Response toWire(const led_control::LedResponse& response)
+{
+    Response wire{};
+    wire.client_id = htonl(response.client_id());
+    wire.request_id = htonl(response.request_id());
+    wire.panel_id = htonl(response.panel_id());
+    wire.version = htonl(response.version());
+    wire.color = static_cast<uint8_t>(response.color());
+    wire.state = response.state() ? 1 : 0;
+    wire.success = response.success() ? 1 : 0;
+    return wire;
+}
+
+// The client side only needs ids and the outcome
+inline uint32_t clientId(const Response& wire)
+{
+    return ntohl(wire.client_id);
+}
+
+inline uint32_t requestId(const Response& wire)
+{
+    return ntohl(wire.request_id);
+}
+
+inline bool succeeded(const Response& wire)
+{
+    return wire.success != 0;
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+
+// AIMD send-rate control driven by the server's LedLoadReports: the rate creeps
+// up by a fixed step per report while the server keeps up, and is halved when it
+// reports congestion (a long queue, shed requests) or requests timed out. Hovers
+// just below the point where the server saturates instead of running into it.
+class RateController
+{
+private:
+    double max_rate;
+    double min_rate;
+    double rate;
+    double increase_step;
+    double target_queue_delay_us;
+    unsigned long last_shed_count{0};
+    bool have_report{false};
+
+public:
+    // Starts at half of 'ceiling' (requests/s) and never leaves [floor, ceiling].
+    // Congestion is a queue that would take longer than 'target_queue_delay_us' to work off.
+    explicit RateController(double ceiling, double floor = 1.0, double target_queue_delay_us = 100000.0)
+        : max_rate(ceiling),
+          min_rate(std::min(floor, ceiling)),
+          rate(std::max(ceiling / 2.0, std::min(floor, ceiling))),
+          increase_step(std::max(ceiling / 20.0, 1.0)),
+          target_queue_delay_us(target_queue_delay_us) {}
+
+    double currentRate() const
+    {
+        return rate;
+    }
+
+    // One load report from the server, plus requests of ours that timed out since
+    // the previous one. Returns true if the rate changed.
+    bool onLoadReport(uint32_t queue_depth, uint32_t service_time_us, uint32_t shed_count,
+                      unsigned long new_timeouts)
+    {
+        bool shed = have_report && shed_count > last_shed_count;
+        last_shed_count = shed_count;
+        have_report = true;
+
+        double queue_delay_us = static_cast<double>(queue_depth) * service_time_us;
+        bool congested = shed || new_timeouts > 0 || queue_delay_us > target_queue_delay_us;
+
+        double previous = rate;
+        rate = congested ? std::max(rate / 2.0, min_rate)
+                         : std::min(rate + increase_step, max_rate);
+        return rate != previous;
+    }
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+/*
+ * Periodically samples a stats collector and serves the latest snapshot
+ * over a Unix domain socket, as a minimal HTTP/1.0 response:
+ *
+ *     curl --unix-socket /tmp/led_server.stats http://localhost/
+ *
+ * Collection runs on the endpoint's own thread, so the request path never
+ * pays for it.
+ */
+class StatsEndpoint
+{
+public:
+    using Collector = std::function<std::string()>;
+
+private:
+    std::string socket_path;
+    Collector collector;
+    std::chrono::milliseconds interval;
+
+    int listen_fd{-1};
+    std::atomic<bool> running{true};
+    std::thread worker;
+
+    std::mutex snapshot_mutex;
+    std::string snapshot{"{}"};
+
+    void refresh()
+    {
+        std::string fresh = collector();
+
+        std::lock_guard<std::mutex> lock(snapshot_mutex);
+        snapshot.swap(fresh);
+    }
+
+    void serve(int client_fd)
+    {
+        // The request itself is irrelevant - every path returns the snapshot.
+        char discard[512];
+        (void)::recv(client_fd, discard, sizeof(discard), MSG_DONTWAIT);
+
+        std::string body;
+        {
+            std::lock_guard<std::mutex> lock(snapshot_mutex);
+            body = snapshot;
+        }
+
+        char header[128];
+        int header_len = std::snprintf(header, sizeof(header),
+            "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+            body.size());
+
+        (void)::send(client_fd, header, header_len, MSG_NOSIGNAL);
+        (void)::send(client_fd, body.data(), body.size(), MSG_NOSIGNAL);
+        ::close(client_fd);
+    }
+
+    void loop()
+    {
+        auto next_refresh = std::chrono::steady_clock::now();
+
+        while(running)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if(now >= next_refresh)
+            {
+                refresh();
+                next_refresh = now + interval;
+            }
+
+            auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(next_refresh - now).count();
+
+            pollfd pfd{listen_fd, POLLIN, 0};
+            if(::poll(&pfd, 1, static_cast<int>(std::min<long long>(wait_ms, 200))) > 0)
+            {
+                int client_fd = ::accept(listen_fd, nullptr, nullptr);
+                if(client_fd >= 0)
+                {
+                    serve(client_fd);
+                }
+            }
+        }
+    }
+
+public:
+    StatsEndpoint(const std::string& path, Collector stats_collector,
+                  std::chrono::milliseconds refresh_interval = std::chrono::milliseconds(1000))
+        : socket_path(path),
+          collector(std::move(stats_collector)),
+          interval(refresh_interval)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if(socket_path.size() >= sizeof(addr.sun_path))
+        {
+            throw std::runtime_error("Stats socket path too long: " + socket_path);
+        }
+        std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(listen_fd < 0)
+        {
+            throw std::runtime_error("Stats socket: " + std::string(std::strerror(errno)));
+        }
+
+        ::unlink(socket_path.c_str());
+        if(::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+           ::listen(listen_fd, 8) < 0)
+        {
+            std::string error = std::strerror(errno);
+            ::close(listen_fd);
+            throw std::runtime_error("Stats socket " + socket_path + ": " + error);
+        }
+
+        worker = std::thread([this]() { loop(); });
+    }
+
+    ~StatsEndpoint()
+    {
+        running = false;
+        if(worker.joinable())
+        {
+            worker.join();
+        }
+        ::close(listen_fd);
+        ::unlink(socket_path.c_str());
+    }
+
+    StatsEndpoint(const StatsEndpoint&) = delete;
+    StatsEndpoint& operator=(const StatsEndpoint&) = delete;
+};
@@ -0,0 +1,571 @@
+#include <chrono>
+#include <thread>
+#include <random>
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+#include "LedLog.hpp"
+#include "LedProfile.hpp"
+#include "LedQos.hpp"
+#include "LedStartup.hpp"
+
+/* Include the C++ DDS API. */
+#include "dds/dds.hpp"
+#include "dds/dds.h"
+
+#include "LedControl.hpp"
+#include "LedWire.hpp"
+
+
+using namespace std::chrono_literals;
+
+
+/*
+ * led_bench: latency and throughput driver for the LED request/response exchange.
+ *
+ * Runs against an already running server, so the server side can be varied
+ * independently, e.g. to compare dispatch modes:
+ *
+ *     led_server --quiet --actuation-us 0 --dispatch waitset    (or listener)
+ *     led_bench --count 20000 --window 32
+ *
+ * Two phases are measured:
+ *  - latency:    one request in flight at a time (ping-pong), round-trip percentiles
+ *  - throughput: '--window' requests kept in flight, completed requests per second
+ *
+ * Both per-request responses and cumulative acks (led_server --ack-interval-ms)
+ * complete requests.
+ *
+ * '--transport udp|unix' runs the same exchange over a plain socket against
+ * led_raw_server instead, as the baseline for what DDS adds.
+ */
+
+
+// How requests reach the server: DDS, or the raw-socket baseline. The driver
+// is independent of it, so every transport is measured the same way.
+class BenchTransport
+{
+public:
+    virtual ~BenchTransport() = default;
+
+    virtual const char* name() const = 0;
+    // Fills in transport-specific fields (e.g. the client id) before sending.
+    virtual void send(led_control::LedRequest& request) = 0;
+
+    // Wait up to 'timeout' for responses, appending the ids of the requests they
+    // complete to 'completed', or to 'failed' for those the server rejected, shed
+    // or cancelled. Returns false on timeout.
+    virtual bool receive(std::vector<uint32_t>& completed, std::vector<uint32_t>& failed,
+                         std::chrono::milliseconds timeout) = 0;
+
+    // Transport-level counters worth seeing next to the results (retransmissions...).
+    virtual void reportCounters() {}
+};
+
+
+class DdsTransport : public BenchTransport
+{
+private:
+    dds::domain::DomainParticipant participant;
+    dds::topic::Topic<led_control::LedRequest> request_topic;
+    dds::topic::Topic<led_control::LedResponse> response_topic;
+    dds::pub::Publisher publisher;
+    dds::sub::Subscriber subscriber;
+    dds::pub::DataWriter<led_control::LedRequest> request_writer;
+    dds::sub::DataReader<led_control::LedResponse> response_reader;
+    dds::topic::Topic<led_control::LedAck> ack_topic;
+    dds::sub::DataReader<led_control::LedAck> ack_reader;
+    dds::sub::cond::ReadCondition response_cond;
+    dds::sub::cond::ReadCondition ack_cond;
+    dds::core::cond::WaitSet waitset;
+
+    uint32_t client_id;
+    uint32_t acked_up_to{0};
+
+    // Responses or cumulative acks, whichever the server sends
+    size_t takeResponses(std::vector<uint32_t>& completed, std::vector<uint32_t>& failed)
+    {
+        size_t before = completed.size() + failed.size();
+
+        auto samples = response_reader.select()
+            .state(unreadData())
+            .take();
+
+        for (const auto& sample : samples)
+        {
+            if(sample.info().valid() && sample.data().client_id() == client_id)
+            {
+                (sample.data().success() ? completed : failed).push_back(sample.data().request_id());
+            }
+        }
+
+        auto acks = ack_reader.select()
+            .state(unreadData())
+            .take();
+
+        for (const auto& sample : acks)
+        {
+            const auto& ack = sample.data();
+            if(sample.info().valid() && ack.client_id() == client_id)
+            {
+                // up_to_id covers the failed ids too: those are reported once, as failed
+                failed.insert(failed.end(), ack.failed_ids().begin(), ack.failed_ids().end());
+                while(acked_up_to < ack.up_to_id())
+                {
+                    ++acked_up_to;
+                    if(std::find(ack.failed_ids().begin(), ack.failed_ids().end(), acked_up_to) == ack.failed_ids().end())
+                    {
+                        completed.push_back(acked_up_to);
+                    }
+                }
+            }
+        }
+
+        return completed.size() + failed.size() - before;
+    }
+
+public:
+    DdsTransport(int domain_id, const LedQosConfig& qos)
+        : participant(domain_id),
+          request_topic(participant, "led_control_requests"),
+          response_topic(participant, "led_control_responses"),
+          publisher(participant),
+          subscriber(participant),
+          request_writer(publisher, request_topic, qos.writerQos(publisher)),
+          response_reader(subscriber, response_topic, qos.readerQos(subscriber)),
+          ack_topic(participant, "led_control_acks"),
+          ack_reader(subscriber, ack_topic, ackReaderQos(subscriber)),
+          response_cond(response_reader, dds::sub::status::DataState::any()),
+          ack_cond(ack_reader, dds::sub::status::DataState::any()),
+          client_id(std::random_device()())
+    {
+        dds::core::cond::StatusCondition writer_matched(request_writer);
+        writer_matched.enabled_statuses(dds::core::status::StatusMask::publication_matched());
+        dds::core::cond::StatusCondition reader_matched(response_reader);
+        reader_matched.enabled_statuses(dds::core::status::StatusMask::subscription_matched());
+
+        dds::core::cond::WaitSet match_waitset;
+        match_waitset += writer_matched;
+        match_waitset += reader_matched;
+
+        if(!waitForMatch(match_waitset, [this]()
+        {
+            return request_writer.publication_matched_status().current_count() >= 1 &&
+                   response_reader.subscription_matched_status().current_count() >= 1;
+        }, 10s))
+        {
+            throw std::runtime_error("No led_server matched within 10 s");
+        }
+
+        waitset += response_cond;
+        waitset += ack_cond;
+    }
+
+    const char* name() const override
+    {
+        return "dds";
+    }
+
+    void send(led_control::LedRequest& request) override
+    {
+        request.client_id(client_id);
+        auto handle = request_writer.register_instance(request);
+        request_writer.write(request, handle);
+        request_writer.unregister_instance(handle);
+    }
+
+    bool receive(std::vector<uint32_t>& completed, std::vector<uint32_t>& failed,
+                 std::chrono::milliseconds timeout) override
+    {
+        if(takeResponses(completed, failed) > 0)
+        {
+            return true;
+        }
+
+        try
+        {
+            waitset.wait(dds::core::Duration::from_millisecs(timeout.count()));
+        }
+        catch(const dds::core::TimeoutError&)
+        {
+            return false;
+        }
+        return takeResponses(completed, failed) > 0;
+    }
+
+    // Retransmissions by our request writer. The server's response writer
+    // reports its own in led_server's statistics (--stats-socket).
+    void reportCounters() override
+    {
+        WriterRetransmits counters = writerRetransmits(request_writer->get_ddsc_entity());
+        led_log::out << name() << " request writer: rexmit_bytes " << counters.rexmit_bytes
+                     << " throttle_count " << counters.throttle_count << led_log::endl;
+    }
+};
+
+
+// One datagram per request/response (LedWire.hpp) to led_raw_server, over UDP
+// or a Unix domain datagram socket. No retransmission: a lost datagram is a timeout.
+class DatagramTransport : public BenchTransport
+{
+private:
+    const char* transport_name;
+    int fd{-1};
+    sockaddr_storage server_addr{};
+    socklen_t server_addr_len{0};
+    uint32_t client_id;
+
+    size_t takeResponses(std::vector<uint32_t>& completed, std::vector<uint32_t>& failed)
+    {
+        size_t before = completed.size() + failed.size();
+        led_wire::Response wire;
+        ssize_t n;
+        while((n = ::recv(fd, &wire, sizeof(wire), MSG_DONTWAIT)) >= 0)
+        {
+            if(n == static_cast<ssize_t>(sizeof(wire)) && led_wire::clientId(wire) == client_id)
+            {
+                (led_wire::succeeded(wire) ? completed : failed).push_back(led_wire::requestId(wire));
+            }
+        }
+        return completed.size() + failed.size() - before;
+    }
+
+    DatagramTransport(const char* name, int family)
+        : transport_name(name),
+          fd(::socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0)),
+          client_id(std::random_device()())
+    {
+        if(fd < 0)
+        {
+            throw std::runtime_error(std::string(name) + " socket: " + std::strerror(errno));
+        }
+    }
+
+public:
+    static std::unique_ptr<DatagramTransport> udp(const char* host, uint16_t port)
+    {
+        std::unique_ptr<DatagramTransport> transport(new DatagramTransport("udp", AF_INET));
+        auto& addr = reinterpret_cast<sockaddr_in&>(transport->server_addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if(inet_pton(AF_INET, host, &addr.sin_addr) != 1)
+        {
+            throw std::runtime_error(std::string("Invalid IPv4 address: ") + host);
+        }
+        transport->server_addr_len = sizeof(addr);
+        return transport;
+    }
+
+    static std::unique_ptr<DatagramTransport> unixSocket(const char* path)
+    {
+        std::unique_ptr<DatagramTransport> transport(new DatagramTransport("unix", AF_UNIX));
+        auto& addr = reinterpret_cast<sockaddr_un&>(transport->server_addr);
+        addr.sun_family = AF_UNIX;
+        if(std::strlen(path) >= sizeof(addr.sun_path))
+        {
+            throw std::runtime_error(std::string("Unix socket path too long: ") + path);
+        }
+        std::strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+        transport->server_addr_len = sizeof(addr);
+
+        // Replies need an address to go to: let the kernel pick an abstract one
+        sa_family_t family = AF_UNIX;
+        if(::bind(transport->fd, reinterpret_cast<sockaddr*>(&family), sizeof(family)) < 0)
+        {
+            throw std::runtime_error(std::string("unix socket bind: ") + std::strerror(errno));
+        }
+        return transport;
+    }
+
+    ~DatagramTransport() override
+    {
+        ::close(fd);
+    }
+
+    DatagramTransport(const DatagramTransport&) = delete;
+    DatagramTransport& operator=(const DatagramTransport&) = delete;
+
+    const char* name() const override
+    {
+        return transport_name;
+    }
+
+    void send(led_control::LedRequest& request) override
+    {
+        request.client_id(client_id);
+        led_wire::Request wire = led_wire::toWire(request);
+        ::sendto(fd, &wire, sizeof(wire), 0, reinterpret_cast<const sockaddr*>(&server_addr), server_addr_len);
+    }
+
+    bool receive(std::vector<uint32_t>& completed, std::vector<uint32_t>& failed,
+                 std::chrono::milliseconds timeout) override
+    {
+        if(takeResponses(completed, failed) > 0)
+        {
+            return true;
+        }
+
+        pollfd pfd{fd, POLLIN, 0};
+        if(::poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0)
+        {
+            return false;
+        }
+        return takeResponses(completed, failed) > 0;
+    }
+};
+
+
+struct BenchResult
+{
+    unsigned long completed = 0;
+    unsigned long failed = 0;       // answered, but not successfully: no latency sample
+    unsigned long timeouts = 0;
+    double seconds = 0.0;
+    std::vector<double> latencies_us;
+};
+
+
+class BenchDriver
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    BenchTransport& transport;
+    std::chrono::milliseconds timeout;
+    unsigned long request_counter{0};
+
+    led_control::LedRequest nextRequest()
+    {
+        led_control::LedRequest request;
+        request.request_id(++request_counter);
+        request.color(static_cast<led_control::LedColor>(request_counter % 3));
+        request.state(request_counter % 2 == 0);
+        return request;
+    }
+
+    static double elapsedUs(Clock::time_point since)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+    }
+
+public:
+    BenchDriver(BenchTransport& bench_transport, std::chrono::milliseconds response_timeout)
+        : transport(bench_transport), timeout(response_timeout) {}
+
+    // Keep 'window' requests in flight until 'count' have completed or timed out.
+    // Each request times out on its own, 'timeout' after it was sent, freeing its
+    // window slot; a response arriving after that is ignored.
+    BenchResult run(unsigned long count, unsigned long window)
+    {
+        BenchResult result;
+        result.latencies_us.reserve(count);
+
+        // By request id, which increases with send time: the oldest comes first
+        std::map<uint32_t, Clock::time_point> in_flight;
+        std::vector<uint32_t> completed;
+        std::vector<uint32_t> failed;
+        unsigned long sent = 0;
+        auto start = Clock::now();
+
+        while(result.completed + result.failed + result.timeouts < count)
+        {
+            while(sent < count && in_flight.size() < window)
+            {
+                auto request = nextRequest();
+                in_flight[request.request_id()] = Clock::now();
+                transport.send(request);
+                ++sent;
+            }
+
+            // Wait no longer than until the oldest request's deadline
+            auto until_deadline = std::chrono::ceil<std::chrono::milliseconds>(
+                in_flight.begin()->second + timeout - Clock::now());
+
+            completed.clear();
+            failed.clear();
+            if(transport.receive(completed, failed, std::max(until_deadline, std::chrono::milliseconds(0))))
+            {
+                for (uint32_t id : completed)
+                {
+                    auto it = in_flight.find(id);
+                    if(it != in_flight.end())
+                    {
+                        result.latencies_us.push_back(elapsedUs(it->second));
+                        ++result.completed;
+                        in_flight.erase(it);
+                    }
+                }
+                for (uint32_t id : failed)
+                {
+                    result.failed += in_flight.erase(id);
+                }
+            }
+
+            auto now = Clock::now();
+            while(!in_flight.empty() && now - in_flight.begin()->second >= timeout)
+            {
+                ++result.timeouts;
+                in_flight.erase(in_flight.begin());
+            }
+        }
+
+        result.seconds = elapsedUs(start) / 1e6;
+        return result;
+    }
+};
+
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if(sorted.empty())
+    {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+
+static void report(const char* transport, const char* phase, unsigned long window, BenchResult result)
+{
+    std::sort(result.latencies_us.begin(), result.latencies_us.end());
+    double mean = result.latencies_us.empty() ? 0.0
+        : std::accumulate(result.latencies_us.begin(), result.latencies_us.end(), 0.0) / result.latencies_us.size();
+
+    led_log::out << transport << " " << phase << " (window " << window << "): "
+                 << result.completed << " ok, " << result.failed << " failed, " << result.timeouts << " timeouts, "
+                 << static_cast<long>(result.completed / std::max(result.seconds, 1e-9)) << " req/s, latency us"
+                 << " mean " << static_cast<long>(mean)
+                 << " p50 " << static_cast<long>(percentile(result.latencies_us, 50))
+                 << " p90 " << static_cast<long>(percentile(result.latencies_us, 90))
+                 << " p99 " << static_cast<long>(percentile(result.latencies_us, 99))
+                 << " max " << static_cast<long>(percentile(result.latencies_us, 100)) << led_log::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+    unsigned long count = 10000;
+    unsigned long warmup = 500;
+    unsigned long window = 32;
+    long timeout_ms = 1000;
+    const char* transport_name = "dds";
+    const char* host = "127.0.0.1";
+    unsigned long udp_port = 17400;
+    const char* unix_path = "/tmp/led_raw.sock";
+    LedQosConfig qos;
+    const char* profile = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if(qos.parseArg(argc, argv, i))
+        {
+            continue;
+        }
+        else if(std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc && isCycloneProfile(argv[i + 1]))
+        {
+            profile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+        {
+            count = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            warmup = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+        {
+            window = std::max(1UL, std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(std::strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc)
+        {
+            timeout_ms = std::atol(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--transport") == 0 && i + 1 < argc &&
+                (std::strcmp(argv[i + 1], "dds") == 0 || std::strcmp(argv[i + 1], "udp") == 0 ||
+                 std::strcmp(argv[i + 1], "unix") == 0))
+        {
+            transport_name = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--host") == 0 && i + 1 < argc)
+        {
+            host = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--udp-port") == 0 && i + 1 < argc)
+        {
+            udp_port = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+        {
+            unix_path = argv[++i];
+        }
+        else
+        {
+            led_log::err << "Usage: " << argv[0]
+                         << " [--count N] [--warmup N] [--window N] [--timeout-ms N]"
+                         << " [--transport dds|udp|unix] [--host IPV4] [--udp-port N] [--unix PATH] "
+                         << cycloneProfileUsage() << " " << LedQosConfig::usage() << led_log::endl;
+
+            return 1;
+        }
+    }
+
+    if(!useProfileCycloneConfig(profile))
+    {
+        return 1;
+    }
+
+    try
+    {
+        qos.validate();
+
+        std::unique_ptr<BenchTransport> transport;
+        if(std::strcmp(transport_name, "udp") == 0)
+        {
+            transport = DatagramTransport::udp(host, static_cast<uint16_t>(udp_port));
+        }
+        else if(std::strcmp(transport_name, "unix") == 0)
+        {
+            transport = DatagramTransport::unixSocket(unix_path);
+        }
+        else
+        {
+            transport = std::make_unique<DdsTransport>(0, qos); // Domain ID 0
+        }
+        BenchDriver driver(*transport, std::chrono::milliseconds(timeout_ms));
+
+        driver.run(warmup, window);
+        report(transport->name(), "latency", 1, driver.run(count, 1));
+        report(transport->name(), "throughput", window, driver.run(count, window));
+        transport->reportCounters();
+    }
+    catch(const dds::core::Exception& e)
+    {
+        led_log::err << "DDS Exception in main: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+    catch(const std::exception& e)
+    {
+        led_log::err << "Exception: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
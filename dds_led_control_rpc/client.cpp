@@ -1,214 +1,150 @@
-#include <iostream>
 #include <chrono>
 #include <thread>
 #include <atomic>
 #include <csignal>
-#include <random>
-#include <map>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
 
-#include "LedControl.hpp"
-
-/* Include the C++ DDS API. */
-#include "dds/dds.hpp"
+#include "LedLog.hpp"
+#include "LedProfile.hpp"
+#include "LedClient.hpp"
+#include "LedTrace.hpp"
+#include "StatsEndpoint.hpp"
+#include "LedStartup.hpp"
 
 
 using namespace std::chrono_literals;
 
 
-class LedClient 
+
+std::atomic<bool> shutdown_flag{false};
+
+
+void signal_handler(int) 
 {
-private:
-    dds::domain::DomainParticipant participant;
-    dds::topic::Topic<led_control::LedRequest> request_topic;
-    dds::topic::Topic<led_control::LedResponse> response_topic;
-    dds::pub::Publisher publisher;
-    dds::sub::Subscriber subscriber;
-    dds::pub::DataWriter<led_control::LedRequest> request_writer;
-    dds::sub::DataReader<led_control::LedResponse> response_reader;
-    
-    std::atomic<bool> running{true};
-    unsigned long request_counter{0};
-    std::map<unsigned long, std::chrono::steady_clock::time_point> pending_requests;
-    
-    std::random_device rd;
-    std::mt19937 gen{rd()};
-    std::uniform_int_distribution<> color_dist{0, 2};
-    std::uniform_int_distribution<> state_dist{0, 1};
-    
-    const char* colorToString(led_control::LedColor color) 
+    shutdown_flag = true;
+}
+
+
+int main(int argc, char** argv) 
+{
+    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
+    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
+
+    // Started first thing, so the report covers the whole startup path.
+    StartupTimer startup;
+
+    const char* stats_socket = nullptr;
+    LedQosConfig qos;
+    const char* profile = nullptr;
+    double rate = 0.0;
+    double stream_hz = 0.0;
+    bool adaptive = false;
+    bool quiet = false;
+    unsigned long panel = 0;
+    std::vector<std::string> replicas;
+    const char* trace_file = nullptr;
+    unsigned long trace_sample = 1;
+
+    for (int i = 1; i < argc; ++i)
     {
-        switch(color) 
+        if(qos.parseArg(argc, argv, i))
         {
-            case led_control::LedColor::RED: return "RED";
-            case led_control::LedColor::GREEN: return "GREEN";
-            case led_control::LedColor::BLUE: return "BLUE";
-            default: return "UNKNOWN";
+            continue;
         }
-    }
-    
-    void sendRequest(led_control::LedColor color, bool state) 
-    {
-        led_control::LedRequest request;
-        request.color(color);
-        request.state(state);
-        request.request_id(++request_counter);
-        
-        std::cout << "Sending request: "
-                  << colorToString(color) 
-                  << " -> " << (state ? "ON" : "OFF")
-                  << " (ID: " << request.request_id() << ")" << std::endl;
-        
-        request_writer.write(request);
-        pending_requests[request.request_id()] = std::chrono::steady_clock::now();
-    }
-    
-    void checkResponses() 
-    {
-        auto samples = response_reader.select()
-            .state(dds::sub::status::DataState::new_data())
-            .take();
-        
-        for (const auto& sample : samples) 
+        else if(std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc && isCycloneProfile(argv[i + 1]))
         {
-            if(sample.info().valid()) 
-            {
-                const auto& response = sample.data();
-                auto it = pending_requests.find(response.request_id());
-                
-                if(it != pending_requests.end()) 
-                {
-                    auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::steady_clock::now() - it->second).count();
-                    
-                    std::cout << "\nReceived response for request ID: " << response.request_id() << std::endl;
-                    std::cout << "  Success: " << (response.success() ? "Yes" : "No") << std::endl;
-                    std::cout << "  Message: " << response.message() << std::endl;
-                    std::cout << "  Color: " << colorToString(response.color()) << std::endl;
-                    std::cout << "  State: " << (response.state() ? "ON" : "OFF") << std::endl;
-                    std::cout << "  Latency: " << latency << "ms" << std::endl;
-                    
-                    pending_requests.erase(it);
-                }
-            }
+            profile = argv[++i];
         }
-        
-        // Check for timeout (5 seconds) - 'erase' request if timed out:
-        auto now = std::chrono::steady_clock::now();
-
-        for (auto it = pending_requests.begin(); it != pending_requests.end(); ) 
+        else if(std::strcmp(argv[i], "--stats-socket") == 0 && i + 1 < argc)
         {
-            if (now - it->second > 5s) 
-            {
-                std::cerr << "Timeout for request ID: " << it->first << std::endl;
-                it = pending_requests.erase(it);
-            } 
-            else 
-            {
-                ++it;
-            }
+            stats_socket = argv[++i];
         }
-    }
-    
-    void sendRandomRequest() 
-    {
-        led_control::LedColor color = static_cast<led_control::LedColor>(color_dist(gen));
-        bool state = state_dist(gen) == 1;
-        sendRequest(color, state);
-    }
-
-public:
-    LedClient(int domain_id = 0) 
-        : participant(domain_id),
-          request_topic(participant, "led_control_requests"),
-          response_topic(participant, "led_control_responses"),
-          publisher(participant),
-          subscriber(participant),
-          request_writer(publisher, request_topic),
-          response_reader(subscriber, response_topic) {
-        
-        // Wait for server to be available
-        dds::core::status::PublicationMatchedStatus status;
-        do 
+        else if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
         {
-            status = request_writer.publication_matched_status();
-            std::this_thread::sleep_for(100ms);
-        } 
-        while(status.current_count() < 1);
-        
-        std::cout << "LED Control Client started" << std::endl;
-        std::cout << "Connected to server" << std::endl;
-    }
-    
-    void run() 
-    {
-        // Send initial test requests - turn ALL the LEDs 'ON':
-        std::cout << "\n=== Sending Initial Test Requests ===" << std::endl;
-        sendRequest(led_control::LedColor::RED, true);
-        std::this_thread::sleep_for(500ms);
-        sendRequest(led_control::LedColor::GREEN, true);
-        std::this_thread::sleep_for(500ms);
-        sendRequest(led_control::LedColor::BLUE, true);
-        
-        // Main loop
-        while(running) 
+            trace_file = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--trace-sample") == 0 && i + 1 < argc)
+        {
+            trace_sample = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            rate = std::atof(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--stream-hz") == 0 && i + 1 < argc)
+        {
+            stream_hz = std::atof(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--panel") == 0 && i + 1 < argc)
+        {
+            panel = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--adaptive") == 0)
+        {
+            adaptive = true;
+        }
+        else if(std::strcmp(argv[i], "--quiet") == 0)
         {
-            try 
+            quiet = true;
+        }
+        else if(std::strcmp(argv[i], "--replicas") == 0 && i + 1 < argc)
+        {
+            // Comma-separated: primary first, then the alternates to hedge to
+            std::string list = argv[++i];
+            for (size_t start = 0, comma; start <= list.size(); start = comma + 1)
             {
-                // Check for responses
-                checkResponses();
-                
-                // Send random request every 2-5 seconds
-                static auto last_request = std::chrono::steady_clock::now();
-                auto now = std::chrono::steady_clock::now();
-                
-                if(now - last_request > 10s) 
+                comma = std::min(list.find(',', start), list.size());
+                if(comma > start)
                 {
-                    //sendRandomRequest();    // Turn random LED randomly ON if OFF, or OFF if ON!
-                    
-                    last_request = now;
+                    replicas.push_back(list.substr(start, comma - start));
                 }
-                
-                std::this_thread::sleep_for(100ms);
-                
-            } 
-            catch(const dds::core::Exception& e) 
-            {
-                std::cerr << "DDS Exception: " << e.what() << std::endl;
             }
         }
+        else
+        {
+            led_log::err << "Usage: " << argv[0] << " [--stats-socket PATH] [--rate REQ_PER_S [--adaptive]] [--stream-hz HZ] [--panel N] [--replicas A,B,...] [--quiet] [--trace FILE [--trace-sample N]] "
+                      << cycloneProfileUsage() << " " << LedQosConfig::usage() << led_log::endl;
+
+            return 1;
+        }
     }
     
-    void stop() 
+    if(trace_file)
     {
-        running = false;
+        led_trace::Tracer::instance().enable(static_cast<uint32_t>(trace_sample));
     }
-    
-    // Method for manual control (can be called from UI or CLI)
-    void manualControl(led_control::LedColor color, bool state) 
+
+    if(!useProfileCycloneConfig(profile))
     {
-        sendRequest(color, state);
+        return 1;
     }
-};
-
-
 
-std::atomic<bool> shutdown_flag{false};
-
-
-void signal_handler(int) 
-{
-    shutdown_flag = true;
-}
-
-
-int main(int argc, char** argv) 
-{
-    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
-    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
-    
     try 
     {
-        LedClient client(0); // Domain ID 0
+        qos.validate();
+        dds::domain::DomainParticipant participant(0); // Domain ID 0
+        startup.mark("participant");
+
+        LedClient client(participant, qos, replicas);   // Returns once the server is matched
+        startup.mark("entities+discovery");
+        client.setStartupTimer(&startup);
+        client.setRequestRate(rate, adaptive);
+        client.setPanel(static_cast<uint32_t>(panel));
+        client.setVerbose(!quiet);
+        client.setSetpointRate(stream_hz);
+
+        // Optional live DDS/application statistics for monitoring
+        std::unique_ptr<StatsEndpoint> stats;
+        if(stats_socket)
+        {
+            stats = std::make_unique<StatsEndpoint>(stats_socket, [&client]() { return client.statsJson(); });
+            led_log::out << "Serving statistics on unix socket: " << stats_socket << led_log::endl;
+        }
         
         // Run client in separate thread
         std::thread client_thread([&client]() {
@@ -220,20 +156,32 @@ int main(int argc, char** argv)
             std::this_thread::sleep_for(100ms);
         }
         
-        std::cout << "\nShutting down client..." << std::endl;
+        led_log::out << "\nShutting down client..." << led_log::endl;
         client.stop();
         client_thread.join();
+
+        if(trace_file)
+        {
+            if(led_trace::Tracer::instance().writeChromeJson(trace_file, "led_client"))
+            {
+                led_log::out << "Trace written to: " << trace_file << led_log::endl;
+            }
+            else
+            {
+                led_log::err << "Could not write trace file: " << trace_file << led_log::endl;
+            }
+        }
         
-        std::cout << "Client stopped successfully" << std::endl;
+        led_log::out << "Client stopped successfully" << led_log::endl;
         
     } catch(const dds::core::Exception& e) {
-        std::cerr << "DDS Exception in main: " << e.what() << std::endl;
+        led_log::err << "DDS Exception in main: " << e.what() << led_log::endl;
 
         return 1;
     } 
     catch(const std::exception& e) 
     {
-        std::cerr << "Exception: " << e.what() << std::endl;
+        led_log::err << "Exception: " << e.what() << led_log::endl;
 
         return 1;
     }
@@ -0,0 +1,406 @@
+#include <chrono>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "LedLog.hpp"
+#include "LedProfile.hpp"
+#include "LedClient.hpp"
+
+
+/*
+ * led_daemon: one long-running, already matched LedClient behind a Unix domain
+ * socket, so scripts can drive the LEDs without paying for a DomainParticipant
+ * and discovery on every invocation.
+ *
+ * Line protocol, one command per line, each starting with a tag of the
+ * caller's choosing that is echoed in the reply:
+ *
+ *     TAG set red|green|blue on|off
+ *     TAG toggle red|green|blue
+ *     TAG store SCENE              (snapshot of the current state)
+ *     TAG recall SCENE
+ *     TAG ping
+ *
+ * Replies are "TAG ok MESSAGE" or "TAG err MESSAGE". Commands may be pipelined:
+ * send any number without waiting. Replies come back as requests complete, so
+ * they may arrive out of order - match them up by tag.
+ *
+ *     printf '1 set red on\n2 recall 3\n' | socat - UNIX-CONNECT:/tmp/led_daemon.sock
+ */
+
+
+std::atomic<bool> shutdown_flag{false};
+
+
+void signal_handler(int)
+{
+    shutdown_flag = true;
+}
+
+
+class ControlDaemon
+{
+private:
+    struct Connection
+    {
+        int fd = -1;
+        std::string in;     // bytes received, up to the last complete line not yet parsed
+        std::string out;    // replies not yet written
+        unsigned long in_flight = 0;
+        bool eof = false;       // peer is done sending, but may still wait for replies
+        bool closing = false;   // close right away, pending replies or not
+    };
+
+    // Lines longer than this are not commands: drop the connection
+    static constexpr size_t MAX_LINE = 256;
+
+    LedClient& client;
+    std::string socket_path;
+    int listen_fd{-1};
+
+    // Keyed by a never-reused id, so a completion for a connection that has gone
+    // away in the meantime finds nothing rather than a new connection on the same fd.
+    std::map<unsigned long, Connection> connections;
+    unsigned long next_connection_id{0};
+
+    static bool parseColor(const char* name, led_control::LedColor& color)
+    {
+        if(std::strcmp(name, "red") == 0)
+        {
+            color = led_control::LedColor::RED;
+        }
+        else if(std::strcmp(name, "green") == 0)
+        {
+            color = led_control::LedColor::GREEN;
+        }
+        else if(std::strcmp(name, "blue") == 0)
+        {
+            color = led_control::LedColor::BLUE;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    void reply(unsigned long connection_id, const std::string& tag, bool ok, const std::string& message)
+    {
+        auto it = connections.find(connection_id);
+        if(it != connections.end())
+        {
+            it->second.out += tag + (ok ? " ok " : " err ") + message + "\n";
+        }
+    }
+
+    void handleLine(unsigned long connection_id, const std::string& line)
+    {
+        char tag[32] = "", command[16] = "", arg1[32] = "", arg2[16] = "";
+        int fields = std::sscanf(line.c_str(), "%31s %15s %31s %15s", tag, command, arg1, arg2);
+        if(fields < 1)
+        {
+            return;     // Blank line
+        }
+
+        led_control::LedRequest request;
+        led_control::LedColor color;
+        bool valid = false;
+
+        if(fields == 2 && std::strcmp(command, "ping") == 0)
+        {
+            reply(connection_id, tag, true, "pong");
+            return;
+        }
+        else if(fields == 4 && std::strcmp(command, "set") == 0 && parseColor(arg1, color) &&
+                (std::strcmp(arg2, "on") == 0 || std::strcmp(arg2, "off") == 0))
+        {
+            request.color(color);
+            request.state(std::strcmp(arg2, "on") == 0);
+            valid = true;
+        }
+        else if(fields == 3 && std::strcmp(command, "toggle") == 0 && parseColor(arg1, color))
+        {
+            request.color(color);
+            request.op(led_control::LedOp::TOGGLE);
+            valid = true;
+        }
+        else if(fields == 3 && (std::strcmp(command, "store") == 0 || std::strcmp(command, "recall") == 0))
+        {
+            char* end = nullptr;
+            unsigned long scene = std::strtoul(arg1, &end, 10);
+            valid = end != arg1 && *end == '\0';
+            request.op(command[0] == 's' ? led_control::LedOp::STORE_SCENE : led_control::LedOp::RECALL_SCENE);
+            request.scene_id(static_cast<uint32_t>(scene));
+        }
+
+        if(!valid)
+        {
+            reply(connection_id, tag, false, "usage: TAG set COLOR on|off | toggle COLOR | store N | recall N | ping");
+            return;
+        }
+
+        ++connections.at(connection_id).in_flight;
+        std::string reply_tag = tag;
+        client.submit(request, [this, connection_id, reply_tag](const led_control::LedResponse& response)
+        {
+            auto it = connections.find(connection_id);
+            if(it != connections.end())
+            {
+                --it->second.in_flight;
+            }
+            reply(connection_id, reply_tag, response.success(), response.message());
+        });
+    }
+
+    void accept()
+    {
+        int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd >= 0)
+        {
+            Connection connection;
+            connection.fd = fd;
+            connections.emplace(next_connection_id++, std::move(connection));
+        }
+    }
+
+    void receive(unsigned long connection_id, Connection& connection)
+    {
+        char buf[4096];
+        ssize_t n = ::recv(connection.fd, buf, sizeof(buf), 0);
+        if(n == 0)
+        {
+            connection.eof = true;
+            return;
+        }
+        if(n < 0)
+        {
+            connection.closing = errno != EAGAIN && errno != EINTR;
+            return;
+        }
+        connection.in.append(buf, static_cast<size_t>(n));
+
+        // Every complete line is a command; keep the unfinished rest for later
+        size_t start = 0;
+        for (size_t end; (end = connection.in.find('\n', start)) != std::string::npos; start = end + 1)
+        {
+            handleLine(connection_id, connection.in.substr(start, end - start));
+        }
+        connection.in.erase(0, start);
+
+        if(connection.in.size() > MAX_LINE)
+        {
+            connection.closing = true;
+        }
+    }
+
+    void transmit(Connection& connection)
+    {
+        ssize_t n = ::send(connection.fd, connection.out.data(), connection.out.size(), MSG_NOSIGNAL);
+        if(n > 0)
+        {
+            connection.out.erase(0, static_cast<size_t>(n));
+        }
+        else if(n < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            connection.closing = true;
+        }
+    }
+
+public:
+    ControlDaemon(LedClient& led_client, const std::string& path)
+        : client(led_client), socket_path(path)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if(socket_path.size() >= sizeof(addr.sun_path))
+        {
+            throw std::runtime_error("Control socket path too long: " + socket_path);
+        }
+        std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(listen_fd < 0)
+        {
+            throw std::runtime_error("Control socket: " + std::string(std::strerror(errno)));
+        }
+
+        ::unlink(socket_path.c_str());
+        if(::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+           ::listen(listen_fd, 64) < 0)
+        {
+            std::string error = std::strerror(errno);
+            ::close(listen_fd);
+            throw std::runtime_error("Control socket " + socket_path + ": " + error);
+        }
+    }
+
+    ~ControlDaemon()
+    {
+        for (auto& entry : connections)
+        {
+            ::close(entry.second.fd);
+        }
+        ::close(listen_fd);
+        ::unlink(socket_path.c_str());
+    }
+
+    ControlDaemon(const ControlDaemon&) = delete;
+    ControlDaemon& operator=(const ControlDaemon&) = delete;
+
+    void run(const std::atomic<bool>& stop)
+    {
+        std::vector<pollfd> fds;
+        std::vector<unsigned long> ids;
+        int client_fd = client.eventFd();
+
+        while(!stop)
+        {
+            // Responses arrive through DDS, not the sockets: the client's readiness
+            // fd wakes us for those (and for its timeouts)
+            fds.assign({pollfd{listen_fd, POLLIN, 0}, pollfd{client_fd, POLLIN, 0}});
+            ids.clear();
+            for (auto& entry : connections)
+            {
+                short events = (entry.second.eof ? 0 : POLLIN) | (entry.second.out.empty() ? 0 : POLLOUT);
+                fds.push_back(pollfd{entry.second.fd, events, 0});
+                ids.push_back(entry.first);
+            }
+
+            // Timeout only to notice 'stop'
+            if(::poll(fds.data(), fds.size(), 100) > 0)
+            {
+                if(fds[0].revents & POLLIN)
+                {
+                    accept();
+                }
+                for (size_t i = 2; i < fds.size(); ++i)
+                {
+                    Connection& connection = connections.at(ids[i - 2]);
+                    if(connection.eof && (fds[i].revents & (POLLHUP | POLLERR)))
+                    {
+                        connection.closing = true;    // Gone altogether, nobody to reply to
+                    }
+                    else if(fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                    {
+                        receive(ids[i - 2], connection);
+                    }
+                }
+            }
+
+            try
+            {
+                client.pollOnce();
+            }
+            catch(const dds::core::Exception& e)
+            {
+                led_log::err << "DDS Exception: " << e.what() << led_log::endl;
+            }
+
+            for (auto it = connections.begin(); it != connections.end(); )
+            {
+                Connection& connection = it->second;
+                if(!connection.out.empty() && !connection.closing)
+                {
+                    transmit(connection);
+                }
+                if(connection.closing || (connection.eof && connection.in_flight == 0 && connection.out.empty()))
+                {
+                    ::close(connection.fd);
+                    it = connections.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+};
+
+
+int main(int argc, char** argv)
+{
+    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
+    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
+
+    const char* socket_path = "/tmp/led_daemon.sock";
+    unsigned long panel = 0;
+    LedQosConfig qos;
+    const char* profile = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if(qos.parseArg(argc, argv, i))
+        {
+            continue;
+        }
+        else if(std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc && isCycloneProfile(argv[i + 1]))
+        {
+            profile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+        {
+            socket_path = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--panel") == 0 && i + 1 < argc)
+        {
+            panel = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            led_log::err << "Usage: " << argv[0] << " [--socket PATH] [--panel N] "
+                         << cycloneProfileUsage() << " " << LedQosConfig::usage() << led_log::endl;
+
+            return 1;
+        }
+    }
+
+    if(!useProfileCycloneConfig(profile))
+    {
+        return 1;
+    }
+
+    try
+    {
+        qos.validate();
+        dds::domain::DomainParticipant participant(0); // Domain ID 0
+
+        LedClient client(participant, qos);   // Returns once the server is matched
+        client.setVerbose(false);
+        client.setPanel(static_cast<uint32_t>(panel));
+
+        ControlDaemon daemon(client, socket_path);
+        led_log::out << "Accepting commands on unix socket: " << socket_path << led_log::endl;
+
+        daemon.run(shutdown_flag);
+
+        led_log::out << "\nShutting down daemon..." << led_log::endl;
+    }
+    catch(const dds::core::Exception& e)
+    {
+        led_log::err << "DDS Exception in main: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+    catch(const std::exception& e)
+    {
+        led_log::err << "Exception: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
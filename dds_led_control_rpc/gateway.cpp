@@ -0,0 +1,564 @@
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+
+#include "LedLog.hpp"
+#include "LedProfile.hpp"
+#include "LedQos.hpp"
+
+/* Include the C++ DDS API. */
+#include "dds/dds.hpp"
+#include "dds/dds.h"
+
+#include "LedControl.hpp"
+
+
+using namespace std::chrono_literals;
+
+
+/*
+ * led_gateway: bridges one "site" domain to several "panel" domains.
+ *
+ * Clients live on the site domain and servers on the panel domains, and each
+ * only discovers its side of the gateways. Discovery traffic and per-node
+ * matching state then grow with the number of nodes in one domain, not on the
+ * whole site.
+ *
+ *     led_gateway --site-domain 0 --route 1:0-999 --route 2:1000-1999
+ *     led_server  (on domain 1) --panels 1000
+ *
+ * A request for panel P is forwarded to the panel domain whose range holds P.
+ * On the way, panel_id is rebased to P - first, so each panel domain's server
+ * numbers its panels from 0. Responses come back the same way, and setpoints
+ * follow the same routes. Cancels carry no panel id and go to every panel
+ * domain. Cumulative acks are not bridged.
+ *
+ * Load reports come up merged per replica name: one site-side report carrying
+ * the most loaded panel domain's queue and service time, and the shed counts of
+ * all of them summed. An --adaptive client's rate spans every route, so it
+ * follows the busiest one.
+ *
+ * Everything taken in one pass is written downstream (or upstream) with write
+ * batching on, and each writer is flushed once per pass: a burst of requests
+ * for one panel domain leaves in as few packets as possible.
+ */
+
+
+std::atomic<bool> shutdown_flag{false};
+
+
+void signal_handler(int)
+{
+    shutdown_flag = true;
+}
+
+
+// Take every unread sample from 'reader' and hand the valid ones to 'forward'.
+// Returns the number forwarded.
+template<typename T, typename Forward>
+unsigned long drain(dds::sub::DataReader<T>& reader, Forward forward)
+{
+    auto samples = reader.select()
+        .state(unreadData())
+        .take();
+
+    unsigned long forwarded = 0;
+    for (const auto& sample : samples)
+    {
+        if(sample.info().valid())
+        {
+            forward(sample.data());
+            ++forwarded;
+        }
+    }
+    return forwarded;
+}
+
+
+// Write one keyed sample and unregister its instance straight away, as the
+// original writers do, so readers on the far side can reclaim it.
+template<typename T>
+void writeOnce(dds::pub::DataWriter<T>& writer, const T& sample)
+{
+    auto handle = writer.register_instance(sample);
+    writer.write(sample, handle);
+    writer.unregister_instance(handle);
+}
+
+
+// One panel domain: panels [first, last] of the site, numbered from 0 in there.
+class PanelDomain
+{
+public:
+    uint32_t first;
+    uint32_t last;
+
+    dds::domain::DomainParticipant participant;
+    dds::topic::Topic<led_control::LedRequest> request_topic;
+    dds::topic::Topic<led_control::LedResponse> response_topic;
+    dds::topic::Topic<led_control::LedSetpoint> setpoint_topic;
+    dds::topic::Topic<led_control::LedCancel> cancel_topic;
+    dds::topic::Topic<led_control::LedLoadReport> load_topic;
+    dds::pub::Publisher publisher;
+    dds::sub::Subscriber subscriber;
+    dds::pub::Publisher bulk_publisher;
+    dds::sub::Subscriber bulk_subscriber;
+    dds::pub::DataWriter<led_control::LedRequest> request_writer;
+    dds::sub::DataReader<led_control::LedResponse> response_reader;
+    dds::pub::DataWriter<led_control::LedSetpoint> setpoint_writer;
+    dds::pub::DataWriter<led_control::LedCancel> cancel_writer;
+    dds::sub::DataReader<led_control::LedLoadReport> load_reader;
+    dds::sub::cond::ReadCondition response_cond;
+    dds::sub::cond::ReadCondition load_cond;
+
+    // Latest load report from each replica serving this domain
+    std::map<std::string, led_control::LedLoadReport> load;
+
+    bool requests_pending{false};    // written since the last flush
+    bool setpoints_pending{false};
+    bool cancels_pending{false};
+
+    PanelDomain(int domain_id, uint32_t first_panel, uint32_t last_panel, const LedQosConfig& qos)
+        : first(first_panel),
+          last(last_panel),
+          participant(domain_id),
+          request_topic(participant, "led_control_requests"),
+          response_topic(participant, "led_control_responses"),
+          setpoint_topic(participant, "led_control_setpoints"),
+          cancel_topic(participant, "led_control_cancels"),
+          load_topic(participant, "led_control_load"),
+          publisher(participant),
+          subscriber(participant),
+          bulk_publisher(bulkPublisher(participant)),
+          bulk_subscriber(bulkSubscriber(participant)),
+          request_writer(publisher, request_topic, qos.writerQos(publisher)),
+          response_reader(subscriber, response_topic, qos.readerQos(subscriber)),
+          setpoint_writer(bulk_publisher, setpoint_topic, setpointWriterQos(bulk_publisher)),
+          cancel_writer(publisher, cancel_topic, cancelWriterQos(publisher)),
+          load_reader(bulk_subscriber, load_topic, loadReportReaderQos(bulk_subscriber)),
+          response_cond(response_reader, dds::sub::status::DataState::any()),
+          load_cond(load_reader, dds::sub::status::DataState::any()) {}
+
+    bool holds(uint32_t panel_id) const
+    {
+        return panel_id >= first && panel_id <= last;
+    }
+
+    void flush()
+    {
+        if(requests_pending)
+        {
+            dds_write_flush(request_writer->get_ddsc_entity());
+            requests_pending = false;
+        }
+        if(setpoints_pending)
+        {
+            dds_write_flush(setpoint_writer->get_ddsc_entity());
+            setpoints_pending = false;
+        }
+        if(cancels_pending)
+        {
+            dds_write_flush(cancel_writer->get_ddsc_entity());
+            cancels_pending = false;
+        }
+    }
+};
+
+
+class Gateway
+{
+private:
+    dds::domain::DomainParticipant participant;
+    dds::topic::Topic<led_control::LedRequest> request_topic;
+    dds::topic::Topic<led_control::LedResponse> response_topic;
+    dds::topic::Topic<led_control::LedSetpoint> setpoint_topic;
+    dds::topic::Topic<led_control::LedCancel> cancel_topic;
+    dds::topic::Topic<led_control::LedLoadReport> load_topic;
+    dds::pub::Publisher publisher;
+    dds::sub::Subscriber subscriber;
+    dds::pub::Publisher bulk_publisher;
+    dds::sub::Subscriber bulk_subscriber;
+    dds::sub::DataReader<led_control::LedRequest> request_reader;
+    dds::pub::DataWriter<led_control::LedResponse> response_writer;
+    dds::sub::DataReader<led_control::LedSetpoint> setpoint_reader;
+    dds::sub::DataReader<led_control::LedCancel> cancel_reader;
+    dds::pub::DataWriter<led_control::LedLoadReport> load_writer;
+
+    std::vector<std::unique_ptr<PanelDomain>> domains;
+    std::atomic<bool> running{true};
+    bool responses_pending{false};
+
+    std::atomic<unsigned long> requests_forwarded{0};
+    std::atomic<unsigned long> responses_forwarded{0};
+    std::atomic<unsigned long> setpoints_forwarded{0};
+    std::atomic<unsigned long> load_reports_forwarded{0};
+    std::atomic<unsigned long> unroutable{0};
+
+    PanelDomain* route(uint32_t panel_id)
+    {
+        for (auto& domain : domains)
+        {
+            if(domain->holds(panel_id))
+            {
+                return domain.get();
+            }
+        }
+        return nullptr;
+    }
+
+    void forwardRequest(const led_control::LedRequest& request)
+    {
+        PanelDomain* domain = route(request.panel_id());
+        if(!domain)
+        {
+            led_control::LedResponse response;
+            response.request_id(request.request_id());
+            response.client_id(request.client_id());
+            response.panel_id(request.panel_id());
+            response.color(request.color());
+            response.success(false);
+            response.message("No route for panel " + std::to_string(request.panel_id()));
+            writeOnce(response_writer, response);
+            responses_pending = true;
+            ++unroutable;
+            return;
+        }
+
+        led_control::LedRequest downstream = request;
+        downstream.panel_id(request.panel_id() - domain->first);
+        writeOnce(domain->request_writer, downstream);
+        domain->requests_pending = true;
+        ++requests_forwarded;
+    }
+
+    void forwardSetpoint(const led_control::LedSetpoint& setpoint)
+    {
+        PanelDomain* domain = route(setpoint.panel_id());
+        if(domain)
+        {
+            led_control::LedSetpoint downstream = setpoint;
+            downstream.panel_id(setpoint.panel_id() - domain->first);
+            domain->setpoint_writer.write(downstream);
+            domain->setpoints_pending = true;
+            ++setpoints_forwarded;
+        }
+    }
+
+    void forwardCancel(const led_control::LedCancel& cancel)
+    {
+        for (auto& domain : domains)
+        {
+            writeOnce(domain->cancel_writer, cancel);
+            domain->cancels_pending = true;
+        }
+    }
+
+    // Publish the site-wide report for 'replica': the panel domain whose queue
+    // takes longest to work off stands for all of them, shed counts are summed.
+    void forwardLoad(const std::string& replica)
+    {
+        led_control::LedLoadReport merged;
+        merged.replica(replica);
+        unsigned long long worst_delay = 0;
+        unsigned long shed = 0;
+        for (auto& domain : domains)
+        {
+            auto it = domain->load.find(replica);
+            if(it == domain->load.end())
+            {
+                continue;
+            }
+            const led_control::LedLoadReport& report = it->second;
+            unsigned long long delay = static_cast<unsigned long long>(report.queue_depth()) * report.service_time_us();
+            if(delay >= worst_delay)
+            {
+                worst_delay = delay;
+                merged.queue_depth(report.queue_depth());
+                merged.service_time_us(report.service_time_us());
+            }
+            shed += report.shed_count();
+        }
+        merged.shed_count(static_cast<uint32_t>(shed));
+
+        load_writer.write(merged);
+        ++load_reports_forwarded;
+    }
+
+    // One pass over everything waiting on either side.
+    void pump()
+    {
+        drain(request_reader, [this](const led_control::LedRequest& request) { forwardRequest(request); });
+        drain(setpoint_reader, [this](const led_control::LedSetpoint& setpoint) { forwardSetpoint(setpoint); });
+        drain(cancel_reader, [this](const led_control::LedCancel& cancel) { forwardCancel(cancel); });
+
+        for (auto& domain : domains)
+        {
+            domain->flush();
+        }
+
+        unsigned long responses = 0;
+        for (auto& domain : domains)
+        {
+            uint32_t first = domain->first;
+            responses += drain(domain->response_reader, [this, first](const led_control::LedResponse& response)
+            {
+                led_control::LedResponse upstream = response;
+                upstream.panel_id(response.panel_id() + first);
+                writeOnce(response_writer, upstream);
+            });
+        }
+        responses_forwarded += responses;
+
+        if(responses_pending || responses > 0)
+        {
+            dds_write_flush(response_writer->get_ddsc_entity());
+            responses_pending = false;
+        }
+
+        std::set<std::string> reported;
+        for (auto& domain : domains)
+        {
+            PanelDomain* from = domain.get();
+            drain(from->load_reader, [from, &reported](const led_control::LedLoadReport& report)
+            {
+                from->load[report.replica()] = report;
+                reported.insert(report.replica());
+            });
+        }
+        for (const auto& replica : reported)
+        {
+            forwardLoad(replica);
+        }
+        if(!reported.empty())
+        {
+            dds_write_flush(load_writer->get_ddsc_entity());
+        }
+    }
+
+public:
+    Gateway(int site_domain, const LedQosConfig& qos)
+        : participant(site_domain),
+          request_topic(participant, "led_control_requests"),
+          response_topic(participant, "led_control_responses"),
+          setpoint_topic(participant, "led_control_setpoints"),
+          cancel_topic(participant, "led_control_cancels"),
+          load_topic(participant, "led_control_load"),
+          publisher(participant),
+          subscriber(participant),
+          bulk_publisher(bulkPublisher(participant)),
+          bulk_subscriber(bulkSubscriber(participant)),
+          request_reader(subscriber, request_topic, qos.readerQos(subscriber)),
+          response_writer(publisher, response_topic, qos.writerQos(publisher)),
+          setpoint_reader(bulk_subscriber, setpoint_topic, setpointReaderQos(bulk_subscriber)),
+          cancel_reader(subscriber, cancel_topic, cancelReaderQos(subscriber)),
+          load_writer(bulk_publisher, load_topic, loadReportWriterQos(bulk_publisher)) {}
+
+    // Serve site panels [first, last] through 'domain_id'. Must be called before run().
+    void addRoute(int domain_id, uint32_t first, uint32_t last, const LedQosConfig& qos)
+    {
+        domains.push_back(std::make_unique<PanelDomain>(domain_id, first, last, qos));
+        led_log::out << "Panels " << static_cast<unsigned long>(first) << "-" << static_cast<unsigned long>(last)
+                     << " -> domain " << domain_id << led_log::endl;
+    }
+
+    void run()
+    {
+        dds::sub::cond::ReadCondition request_cond(request_reader, dds::sub::status::DataState::any());
+        dds::sub::cond::ReadCondition setpoint_cond(setpoint_reader, dds::sub::status::DataState::any());
+        dds::sub::cond::ReadCondition cancel_cond(cancel_reader, dds::sub::status::DataState::any());
+
+        dds::core::cond::WaitSet waitset;
+        waitset += request_cond;
+        waitset += setpoint_cond;
+        waitset += cancel_cond;
+        for (auto& domain : domains)
+        {
+            waitset += domain->response_cond;
+            waitset += domain->load_cond;
+        }
+
+        while(running)
+        {
+            try
+            {
+                pump();
+                waitset.wait(dds::core::Duration::from_millisecs(100));
+            }
+            catch(const dds::core::TimeoutError&)
+            {
+                // Periodic wake-up to check 'running'
+            }
+            catch(const dds::core::Exception& e)
+            {
+                led_log::err << "DDS Exception: " << e.what() << led_log::endl;
+            }
+        }
+    }
+
+    void stop()
+    {
+        running = false;
+    }
+
+    void report()
+    {
+        led_log::out << "Forwarded " << requests_forwarded.load() << " requests, "
+                     << responses_forwarded.load() << " responses, "
+                     << setpoints_forwarded.load() << " setpoints, "
+                     << load_reports_forwarded.load() << " load reports; "
+                     << unroutable.load() << " requests had no route" << led_log::endl;
+    }
+};
+
+
+// "DOMAIN:FIRST-LAST", FIRST <= LAST
+static bool parseRoute(const char* arg, int& domain_id, uint32_t& first, uint32_t& last)
+{
+    char* end = nullptr;
+    long domain = std::strtol(arg, &end, 10);
+    if(end == arg || *end != ':' || domain < 0)
+    {
+        return false;
+    }
+    const char* range = end + 1;
+    unsigned long from = std::strtoul(range, &end, 10);
+    if(end == range || *end != '-')
+    {
+        return false;
+    }
+    range = end + 1;
+    unsigned long to = std::strtoul(range, &end, 10);
+    if(end == range || *end != '\0' || to < from || to > UINT32_MAX)
+    {
+        return false;
+    }
+
+    domain_id = static_cast<int>(domain);
+    first = static_cast<uint32_t>(from);
+    last = static_cast<uint32_t>(to);
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
+    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
+
+    struct Route
+    {
+        int domain_id;
+        uint32_t first;
+        uint32_t last;
+    };
+
+    int site_domain = 0;
+    std::vector<Route> routes;
+    LedQosConfig qos;
+    const char* profile = nullptr;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc && !usage_error; ++i)
+    {
+        Route route{0, 0, 0};
+        if(qos.parseArg(argc, argv, i))
+        {
+            continue;
+        }
+        else if(std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc && isCycloneProfile(argv[i + 1]))
+        {
+            profile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--site-domain") == 0 && i + 1 < argc)
+        {
+            site_domain = std::atoi(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--route") == 0 && i + 1 < argc &&
+                parseRoute(argv[i + 1], route.domain_id, route.first, route.last))
+        {
+            // Each panel must have exactly one route: the first match would win silently
+            for (const auto& other : routes)
+            {
+                if(route.first <= other.last && other.first <= route.last)
+                {
+                    led_log::err << "--route " << argv[i + 1] << " overlaps panels "
+                                 << static_cast<unsigned long>(other.first) << "-"
+                                 << static_cast<unsigned long>(other.last) << led_log::endl;
+                    usage_error = true;
+                }
+            }
+            routes.push_back(route);
+            ++i;
+        }
+        else
+        {
+            usage_error = true;
+        }
+    }
+
+    if(usage_error || routes.empty())
+    {
+        led_log::err << "Usage: " << argv[0] << " [--site-domain N] --route DOMAIN:FIRST-LAST [--route ...] "
+                     << cycloneProfileUsage() << " " << LedQosConfig::usage() << led_log::endl;
+
+        return 1;
+    }
+
+    if(!useProfileCycloneConfig(profile))
+    {
+        return 1;
+    }
+
+    try
+    {
+        qos.validate();
+
+        // Samples are queued per writer until the gateway flushes it, once per pass
+        dds_write_set_batch(true);
+
+        Gateway gateway(site_domain, qos);
+        for (const auto& route : routes)
+        {
+            gateway.addRoute(route.domain_id, route.first, route.last, qos);
+        }
+        led_log::out << "Gateway for site domain " << site_domain << " ready" << led_log::endl;
+
+        std::thread gateway_thread([&gateway]()
+        {
+            gateway.run();
+        });
+
+        // Wait for shutdown signal
+        while(!shutdown_flag)
+        {
+            std::this_thread::sleep_for(100ms);
+        }
+
+        led_log::out << "\nShutting down gateway..." << led_log::endl;
+        gateway.stop();
+        gateway_thread.join();
+        gateway.report();
+    }
+    catch(const dds::core::Exception& e)
+    {
+        led_log::err << "DDS Exception in main: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+    catch(const std::exception& e)
+    {
+        led_log::err << "Exception: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
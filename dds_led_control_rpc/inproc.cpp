@@ -0,0 +1,119 @@
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+
+#include "LedLog.hpp"
+#include "LedProfile.hpp"
+#include "LedServer.hpp"
+#include "LedClient.hpp"
+
+
+using namespace std::chrono_literals;
+
+
+/*
+ * Runs LedServer and LedClient in one process, on one shared DomainParticipant.
+ *
+ * By default requests still travel through DDS, but Cyclone delivers them
+ * intra-process (no sockets involved). With '--direct' the client calls the
+ * server's request handler directly, skipping DDS and serialization altogether.
+ */
+
+
+std::atomic<bool> shutdown_flag{false};
+
+
+void signal_handler(int)
+{
+    shutdown_flag = true;
+}
+
+
+int main(int argc, char** argv)
+{
+    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
+    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
+
+    bool direct = false;
+    const char* profile = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--direct") == 0)
+        {
+            direct = true;
+        }
+        else if(std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc && isCycloneProfile(argv[i + 1]))
+        {
+            profile = argv[++i];
+        }
+        else
+        {
+            led_log::err << "Usage: " << argv[0] << " [--direct] " << cycloneProfileUsage() << led_log::endl;
+
+            return 1;
+        }
+    }
+
+    if(!useProfileCycloneConfig(profile))
+    {
+        return 1;
+    }
+
+    try
+    {
+        dds::domain::DomainParticipant participant(0); // Domain ID 0
+
+        LedServer server(participant);
+        LedClient client(participant);
+
+        if(direct)
+        {
+            client.setDirectHandler([&server](const led_control::LedRequest& request)
+            {
+                return server.handleRequest(request);
+            });
+            led_log::out << "Direct in-memory request path enabled" << led_log::endl;
+        }
+
+        std::thread server_thread([&server]()
+        {
+            server.run();
+        });
+
+        std::thread client_thread([&client]()
+        {
+            client.run();
+        });
+
+        // Wait for shutdown signal
+        while(!shutdown_flag)
+        {
+            std::this_thread::sleep_for(100ms);
+        }
+
+        led_log::out << "\nShutting down..." << led_log::endl;
+        client.stop();
+        client_thread.join();
+        server.stop();
+        server_thread.join();
+
+        led_log::out << "Stopped successfully" << led_log::endl;
+    }
+    catch(const dds::core::Exception& e)
+    {
+        led_log::err << "DDS Exception in main: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+    catch(const std::exception& e)
+    {
+        led_log::err << "Exception: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <chrono>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <string>
+#include <stdexcept>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+#include "LedLog.hpp"
+#include "LedPanels.hpp"
+#include "LedWire.hpp"
+
+
+/*
+ * led_raw_server: the DDS-free baseline for led_bench. Serves the plain
+ * LedRequest/LedResponse exchange (LedWire.hpp) over a UDP socket and a Unix
+ * domain datagram socket, answering each datagram to its sender:
+ *
+ *     led_raw_server --actuation-us 0
+ *     led_bench --transport udp     (or unix, or dds against led_server)
+ *
+ * Requests are applied by LedPanels::handleRequest(), exactly as led_server
+ * does, so the difference to a led_bench --transport dds run is the transport:
+ * Cyclone's serialization, discovery, reliability and delivery threads. No DDS
+ * entity is created here, so none of Cyclone's threads compete with it either.
+ */
+
+
+std::atomic<bool> shutdown_flag{false};
+
+
+void signal_handler(int)
+{
+    shutdown_flag = true;
+}
+
+
+static int openUdp(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+    {
+        throw std::runtime_error("UDP socket: " + std::string(std::strerror(errno)));
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("UDP port " + std::to_string(port) + ": " + error);
+    }
+    return fd;
+}
+
+
+static int openUnix(const std::string& path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::runtime_error("Unix socket path too long: " + path);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+    {
+        throw std::runtime_error("Unix socket: " + std::string(std::strerror(errno)));
+    }
+
+    ::unlink(path.c_str());
+    if(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Unix socket " + path + ": " + error);
+    }
+    return fd;
+}
+
+
+// Answer every request datagram waiting on 'fd'. Returns how many.
+static unsigned long serve(int fd, LedPanels& panels)
+{
+    unsigned long served = 0;
+    led_wire::Request wire;
+    sockaddr_storage from;
+
+    for (;;)
+    {
+        socklen_t from_len = sizeof(from);
+        ssize_t n = ::recvfrom(fd, &wire, sizeof(wire), MSG_TRUNC, reinterpret_cast<sockaddr*>(&from), &from_len);
+        if(n < 0)
+        {
+            return served;  // EAGAIN: drained
+        }
+        if(n != static_cast<ssize_t>(sizeof(wire)))
+        {
+            continue;       // Not one of ours
+        }
+
+        led_wire::Response response = led_wire::toWire(panels.handleRequest(led_wire::fromWire(wire)));
+        ::sendto(fd, &response, sizeof(response), 0, reinterpret_cast<sockaddr*>(&from), from_len);
+        ++served;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
+    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
+
+    unsigned long udp_port = 17400;
+    const char* unix_path = "/tmp/led_raw.sock";
+    long actuation_us = 10000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--udp-port") == 0 && i + 1 < argc)
+        {
+            udp_port = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+        {
+            unix_path = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--actuation-us") == 0 && i + 1 < argc)
+        {
+            actuation_us = std::atol(argv[++i]);
+        }
+        else
+        {
+            led_log::err << "Usage: " << argv[0] << " [--udp-port N] [--unix PATH] [--actuation-us N]"
+                         << led_log::endl;
+
+            return 1;
+        }
+    }
+
+    int udp_fd = -1;
+    int unix_fd = -1;
+
+    try
+    {
+        LedPanels panels;
+        panels.setActuationDelay(std::chrono::microseconds(actuation_us));
+
+        udp_fd = openUdp(static_cast<uint16_t>(udp_port));
+        unix_fd = openUnix(unix_path);
+        led_log::out << "Serving raw requests on udp port " << udp_port
+                     << " and unix socket " << unix_path << led_log::endl;
+
+        unsigned long served = 0;
+        pollfd fds[2] = {{udp_fd, POLLIN, 0}, {unix_fd, POLLIN, 0}};
+        while(!shutdown_flag)
+        {
+            if(::poll(fds, 2, 100) > 0)
+            {
+                served += serve(udp_fd, panels);
+                served += serve(unix_fd, panels);
+            }
+        }
+
+        led_log::out << "\nShutting down raw server after " << served << " requests" << led_log::endl;
+    }
+    catch(const std::exception& e)
+    {
+        led_log::err << "Exception: " << e.what() << led_log::endl;
+
+        return 1;
+    }
+
+    if(udp_fd >= 0)
+    {
+        ::close(udp_fd);
+    }
+    if(unix_fd >= 0)
+    {
+        ::close(unix_fd);
+        ::unlink(unix_path);
+    }
+    return 0;
+}
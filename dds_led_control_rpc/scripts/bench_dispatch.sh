@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+#
+# Compare led_server's WaitSet and Listener dispatch modes with led_bench.
+#
+#   scripts/bench_dispatch.sh BUILD_DIR [COUNT] [WINDOW] [ACTUATION_US]
+#
+# The server runs quiet, with the given simulated actuation time (default 0, so
+# dispatch overhead is not hidden behind it). Listener mode only accepts up to
+# 1000 us.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 BUILD_DIR [COUNT] [WINDOW] [ACTUATION_US]}
+COUNT=${2:-20000}
+WINDOW=${3:-32}
+ACTUATION_US=${4:-0}
+
+SERVER_PID=
+trap '[[ -n "$SERVER_PID" ]] && kill -INT "$SERVER_PID" 2>/dev/null; wait 2>/dev/null || true' EXIT
+
+for mode in waitset listener; do
+    "$BUILD_DIR/led_server" --quiet --dispatch "$mode" --actuation-us "$ACTUATION_US" > /dev/null &
+    SERVER_PID=$!
+
+    echo "== dispatch: $mode"
+    "$BUILD_DIR/led_bench" --count "$COUNT" --window "$WINDOW"
+
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID" || true
+    SERVER_PID=
+done
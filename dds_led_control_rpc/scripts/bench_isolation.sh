@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+#
+# Control-path latency under bulk load, with and without the 'isolation'
+# Cyclone overlay (config/cyclonedds-isolation.xml).
+#
+#   scripts/bench_isolation.sh BUILD_DIR [BASE_PROFILE] [STREAMS] [STREAM_HZ] [COUNT]
+#
+# led_server runs quiet, with no simulated actuation. STREAMS led_client
+# processes (default 4) each stream setpoints at STREAM_HZ (default 5000) as
+# bulk load. Meanwhile led_bench measures request/response latency and
+# throughput over COUNT requests. This runs twice: once with BASE_PROFILE
+# (default lan-multicast) alone, and once with BASE_PROFILE,isolation. The
+# real-time thread priorities in the overlay need CAP_SYS_NICE (or run as root).
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 BUILD_DIR [BASE_PROFILE] [STREAMS] [STREAM_HZ] [COUNT]}
+BASE=${2:-lan-multicast}
+STREAMS=${3:-4}
+STREAM_HZ=${4:-5000}
+COUNT=${5:-20000}
+
+PIDS=()
+trap 'kill -INT "${PIDS[@]}" 2>/dev/null; wait 2>/dev/null || true' EXIT
+
+for profile in "$BASE" "$BASE,isolation"; do
+    "$BUILD_DIR/led_server" --quiet --actuation-us 0 --profile "$profile" > /dev/null &
+    PIDS=($!)
+    for (( i = 0; i < STREAMS; i++ )); do
+        "$BUILD_DIR/led_client" --quiet --stream-hz "$STREAM_HZ" --profile "$profile" > /dev/null &
+        PIDS+=($!)
+    done
+    sleep 2
+
+    echo "== profile: $profile, $STREAMS x $STREAM_HZ Hz setpoint streams"
+    "$BUILD_DIR/led_bench" --count "$COUNT" --profile "$profile"
+
+    kill -INT "${PIDS[@]}"
+    wait "${PIDS[@]}" || true
+    PIDS=()
+done
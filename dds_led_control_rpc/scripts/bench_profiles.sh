@@ -0,0 +1,68 @@
+#!/usr/bin/env bash
+#
+# Measure the bundled Cyclone DDS configurations (config/cyclonedds-*.xml)
+# with led_bench, against Cyclone's defaults.
+#
+#   scripts/bench_profiles.sh BUILD_DIR [COUNT] [WINDOW] [PROFILE...]
+#
+# Both led_server (quiet, no simulated actuation) and led_bench run with the
+# same '--profile'. On one host, only loopback (and default) say anything about
+# a deployment. For the LAN profiles, run this with SERVER_HOST=user@host to
+# start led_server there over ssh, from the same BUILD_DIR path. Prints one
+# line per profile: ping-pong p50/p99 in us, windowed throughput and timeouts.
+# Full led_bench output goes to BUILD_DIR/profiles/.
+
+set -euo pipefail
+
+BUILD_DIR=$(cd "${1:?usage: $0 BUILD_DIR [COUNT] [WINDOW] [PROFILE...]}" && pwd)
+COUNT=${2:-20000}
+WINDOW=${3:-32}
+shift $(( $# < 3 ? $# : 3 ))
+PROFILES=("$@")
+[[ ${#PROFILES[@]} -gt 0 ]] || PROFILES=(default loopback lan-unicast lan-multicast lowmem)
+OUT_DIR="$BUILD_DIR/profiles"
+
+SERVER_PID=
+stop_server() {
+    if [[ -n "${SERVER_HOST:-}" ]]; then
+        ssh "$SERVER_HOST" "pkill -INT -x led_server" || true
+    fi
+    if [[ -n "$SERVER_PID" ]]; then
+        kill -INT "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        SERVER_PID=
+    fi
+}
+trap stop_server EXIT
+
+mkdir -p "$OUT_DIR"
+printf "%-14s %9s %9s %10s %9s\n" profile p50_us p99_us req/s timeouts
+
+for profile in "${PROFILES[@]}"; do
+    args=()
+    [[ $profile == default ]] || args=(--profile "$profile")
+
+    if [[ -n "${SERVER_HOST:-}" ]]; then
+        ssh "$SERVER_HOST" "$BUILD_DIR/led_server" --quiet --actuation-us 0 "${args[@]}" > /dev/null &
+    else
+        "$BUILD_DIR/led_server" --quiet --actuation-us 0 "${args[@]}" > /dev/null &
+    fi
+    SERVER_PID=$!
+    sleep 2
+
+    log="$OUT_DIR/$profile.bench.log"
+    "$BUILD_DIR/led_bench" --count "$COUNT" --window "$WINDOW" "${args[@]}" > "$log" 2>&1 || true
+    stop_server
+
+    awk -v profile="$profile" '
+        function field(name, offset,    i) {
+            for (i = 1; i <= NF; i++) if ($i == name) return $(i + offset)
+            return ""
+        }
+        / latency \(/    { p50 = field("p50", 1); p99 = field("p99", 1); timeouts += field("timeouts,", -1) }
+        / throughput \(/ { goodput = field("req/s,", -1); timeouts += field("timeouts,", -1) }
+        END {
+            if (goodput == "") { printf "%-14s %9s\n", profile, "failed"; exit }
+            printf "%-14s %9s %9s %10s %9d\n", profile, p50, p99, goodput, timeouts
+        }' "$log"
+done
@@ -0,0 +1,38 @@
+#!/usr/bin/env bash
+#
+# What DDS costs over a bare socket: the same LedRequest/LedResponse exchange
+# measured by led_bench over DDS (against led_server) and over UDP and a Unix
+# domain datagram socket (against led_raw_server).
+#
+#   scripts/bench_transports.sh BUILD_DIR [COUNT] [WINDOW] [ACTUATION_US]
+#
+# Both servers run with the same simulated actuation time (default 0, so the
+# transport is all that differs) and apply requests through the same
+# LedPanels::handleRequest().
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 BUILD_DIR [COUNT] [WINDOW] [ACTUATION_US]}
+COUNT=${2:-20000}
+WINDOW=${3:-32}
+ACTUATION_US=${4:-0}
+
+SERVER_PID=
+trap '[[ -n "$SERVER_PID" ]] && kill -INT "$SERVER_PID" 2>/dev/null; wait 2>/dev/null || true' EXIT
+
+for transport in dds udp unix; do
+    if [[ $transport == dds ]]; then
+        "$BUILD_DIR/led_server" --quiet --actuation-us "$ACTUATION_US" > /dev/null &
+    else
+        "$BUILD_DIR/led_raw_server" --actuation-us "$ACTUATION_US" > /dev/null &
+    fi
+    SERVER_PID=$!
+    sleep 1
+
+    echo "== transport: $transport"
+    "$BUILD_DIR/led_bench" --transport "$transport" --count "$COUNT" --window "$WINDOW"
+
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID" || true
+    SERVER_PID=
+done
@@ -0,0 +1,91 @@
+#!/usr/bin/env bash
+#
+# CPU flame graphs of led_server and led_client under load.
+#
+#   scripts/flamegraph.sh BUILD_DIR [DURATION_S] [RATE]
+#
+# BUILD_DIR should be a Profile build (-DCMAKE_BUILD_TYPE=Profile), or our own
+# frames can't be unwound; 'cmake --build BUILD_DIR --target flamegraph' runs
+# this on it. led_client drives a quiet led_server (no simulated actuation) at
+# RATE requests/s (default 2000), and after a short warm-up both are sampled
+# with perf for DURATION_S seconds (default 10).
+#
+# Needs perf, and Brendan Gregg's FlameGraph scripts (stackcollapse-perf.pl,
+# flamegraph.pl) on PATH or in FLAMEGRAPH_DIR. Writes BUILD_DIR/flamegraph/
+# {led_server,led_client}.svg plus the folded stacks, and prints which share of
+# each process's samples passes through DDS serialization, logging, allocation
+# and our own classes. The shares are inclusive, so they overlap: "own code"
+# also covers the DDS calls made from it.
+
+set -euo pipefail
+
+BUILD_DIR=$(cd "${1:?usage: $0 BUILD_DIR [DURATION_S] [RATE]}" && pwd)
+DURATION=${2:-10}
+RATE=${3:-2000}
+OUT_DIR="$BUILD_DIR/flamegraph"
+
+find_tool() {
+    if [[ -n "${FLAMEGRAPH_DIR:-}" && -x "$FLAMEGRAPH_DIR/$1" ]]; then
+        echo "$FLAMEGRAPH_DIR/$1"
+    elif command -v "$1" > /dev/null; then
+        command -v "$1"
+    else
+        echo "$1 not found: get https://github.com/brendangregg/FlameGraph and set FLAMEGRAPH_DIR" >&2
+        exit 1
+    fi
+}
+
+command -v perf > /dev/null || { echo "perf not found" >&2; exit 1; }
+STACKCOLLAPSE=$(find_tool stackcollapse-perf.pl)
+FLAMEGRAPH=$(find_tool flamegraph.pl)
+
+mkdir -p "$OUT_DIR"
+
+SERVER_PID=
+CLIENT_PID=
+trap 'kill -INT $CLIENT_PID $SERVER_PID 2>/dev/null; wait 2>/dev/null || true' EXIT
+
+"$BUILD_DIR/led_server" --quiet --actuation-us 0 > /dev/null &
+SERVER_PID=$!
+"$BUILD_DIR/led_client" --quiet --rate "$RATE" > /dev/null &
+CLIENT_PID=$!
+
+# Discovery, then let the request rate settle
+sleep 3
+
+perf record -F 999 -g -o "$OUT_DIR/led_server.data" -p "$SERVER_PID" -- sleep "$DURATION" 2> /dev/null &
+SERVER_PERF=$!
+perf record -F 999 -g -o "$OUT_DIR/led_client.data" -p "$CLIENT_PID" -- sleep "$DURATION" 2> /dev/null &
+CLIENT_PERF=$!
+wait "$SERVER_PERF" "$CLIENT_PERF"
+
+kill -INT "$CLIENT_PID" "$SERVER_PID"
+wait "$CLIENT_PID" "$SERVER_PID" || true
+CLIENT_PID=
+SERVER_PID=
+
+summarize() {
+    awk -v name="$1" '
+        {
+            n = $NF
+            total += n
+            if ($0 ~ /serdata|dds_stream_|cdr_stream|::cdr::/) serialization += n
+            if ($0 ~ /led_log::|basic_ostream|_IO_file|_IO_new_file|vfprintf/) logging += n
+            if ($0 ~ /(^|;)(malloc|calloc|realloc|free|cfree|_int_malloc|_int_free|operator new|operator delete)/) allocation += n
+            if ($0 ~ /(^|;)(LedServer|LedClient|ReadinessFd|RateController|led_trace::|led_co::)/) own += n
+        }
+        END {
+            if (total == 0) { printf "%-12s no samples\n", name; exit }
+            printf "%-12s %8d samples  serialization %5.1f%%  logging %5.1f%%  allocation %5.1f%%  own code %5.1f%%\n",
+                   name, total, 100 * serialization / total, 100 * logging / total,
+                   100 * allocation / total, 100 * own / total
+        }' "$OUT_DIR/$1.folded"
+}
+
+for name in led_server led_client; do
+    perf script -i "$OUT_DIR/$name.data" 2> /dev/null | "$STACKCOLLAPSE" > "$OUT_DIR/$name.folded"
+    "$FLAMEGRAPH" --title "$name, $RATE requests/s" "$OUT_DIR/$name.folded" > "$OUT_DIR/$name.svg"
+    summarize "$name"
+done
+
+echo "Flame graphs: $OUT_DIR/led_server.svg $OUT_DIR/led_client.svg"
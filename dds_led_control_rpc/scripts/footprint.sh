@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+#
+# Compare binary size and steady-state RSS of led_server between the default
+# and the low-memory (LED_LOW_MEMORY) build profiles.
+#
+#   scripts/footprint.sh [SETTLE_S]
+#
+# Each profile is configured and built in its own directory next to this
+# project; led_server is then started idle and its RSS read after SETTLE_S
+# seconds (default 10).
+
+set -euo pipefail
+
+SRC_DIR=$(cd "$(dirname "$0")/.." && pwd)
+SETTLE=${1:-10}
+
+measure() {
+    local name=$1; shift
+    local build_dir="$SRC_DIR/build-footprint-$name"
+
+    cmake -S "$SRC_DIR" -B "$build_dir" -DCMAKE_BUILD_TYPE=Release "$@" > /dev/null
+    cmake --build "$build_dir" --target led_server -j"$(nproc)" > /dev/null
+
+    local size_bytes
+    size_bytes=$(stat -c %s "$build_dir/led_server")
+    local text_bytes
+    text_bytes=$(size "$build_dir/led_server" | awk 'NR == 2 { print $1 }')
+
+    "$build_dir/led_server" > /dev/null &
+    local pid=$!
+    sleep "$SETTLE"
+    local rss_kb
+    rss_kb=$(awk '/^VmRSS:/ { print $2 }' "/proc/$pid/status")
+    kill -INT "$pid"
+    wait "$pid" || true
+
+    printf "%-10s %12s %12s %10s\n" "$name" "$size_bytes" "$text_bytes" "$rss_kb"
+}
+
+printf "%-10s %12s %12s %10s\n" "profile" "file_bytes" "text_bytes" "rss_kb"
+measure default -DLED_LOW_MEMORY=OFF
+measure lowmem -DLED_LOW_MEMORY=ON
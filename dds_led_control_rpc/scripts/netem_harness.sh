@@ -0,0 +1,155 @@
+#!/usr/bin/env bash
+#
+# Request/response behaviour under packet loss, delay and reordering, per QoS
+# profile, on one machine: led_server and led_bench run in two network
+# namespaces joined by a veth pair, with a tc netem profile on both ends.
+#
+#   sudo scripts/netem_harness.sh BUILD_DIR [COUNT] [WINDOW]
+#
+# For every (netem profile, QoS profile) pair this prints:
+#   goodput      completed requests/s in led_bench's throughput phase (WINDOW in flight)
+#   p50/p99      round-trip latency of the ping-pong phase, in us
+#   failed       requests the server answered unsuccessfully (rejected, shed or
+#                cancelled), both phases; not counted in goodput or latency
+#   timeouts     requests unanswered within led_bench's timeout, both phases
+#   req_rexmit   bytes the client's request writer retransmitted (Cyclone statistics)
+#   resp_rexmit  bytes the server's response writer retransmitted, read from its
+#                --stats-socket just before it is stopped
+#   pkts/req     packets put on the wire, both directions, per completed request
+#                (discovery and warmup traffic included)
+#
+# Needs root, iproute2 (ip, tc), the sch_netem module and curl. Raw logs go to
+# BUILD_DIR/netem/.
+
+set -euo pipefail
+
+BUILD_DIR=$(cd "${1:?usage: $0 BUILD_DIR [COUNT] [WINDOW]}" && pwd)
+COUNT=${2:-2000}
+WINDOW=${3:-16}
+OUT_DIR="$BUILD_DIR/netem"
+STATS_SOCKET=/tmp/led_netem_server.$$.stats
+
+[[ $EUID -eq 0 ]] || { echo "needs root: network namespaces and tc" >&2; exit 1; }
+
+NS_SERVER=led_srv
+NS_CLIENT=led_cli
+VETH_SERVER=veth_led_srv
+VETH_CLIENT=veth_led_cli
+
+# tc netem arguments, applied to egress on both ends (so delays add up per round trip)
+NETEM_NAMES=(clean loss1 loss5 delay20 reorder wan)
+declare -A NETEM=(
+    [clean]=""
+    [loss1]="loss 1%"
+    [loss5]="loss 5%"
+    [delay20]="delay 20ms 5ms distribution normal"
+    [reorder]="delay 10ms reorder 25% 50%"
+    [wan]="delay 40ms 10ms distribution normal loss 2% reorder 5% 50%"
+)
+
+# LedQosConfig options for the request/response endpoints, passed to both sides
+QOS_NAMES=(best-effort reliable reliable-keepall)
+declare -A QOS=(
+    [best-effort]="--reliability best-effort"
+    [reliable]="--reliability reliable"
+    [reliable-keepall]="--reliability reliable --history all"
+)
+
+SERVER_PID=
+cleanup() {
+    [[ -n "$SERVER_PID" ]] && kill -INT "$SERVER_PID" 2>/dev/null && wait "$SERVER_PID" 2>/dev/null
+    rm -f "$STATS_SOCKET"
+    ip netns del "$NS_SERVER" 2>/dev/null || true
+    ip netns del "$NS_CLIENT" 2>/dev/null || true
+}
+trap cleanup EXIT
+
+setup_namespace() {
+    local ns=$1 dev=$2 addr=$3
+    ip link set "$dev" netns "$ns"
+    ip -n "$ns" link set lo up
+    ip -n "$ns" addr add "$addr/24" dev "$dev"
+    ip -n "$ns" link set "$dev" up
+    # Discovery is multicast, and there is no default route to carry it
+    ip -n "$ns" route add 224.0.0.0/4 dev "$dev"
+}
+
+# Pin Cyclone to the veth: nothing else in the namespace could reach the peer anyway
+cyclone_uri() {
+    echo "<CycloneDDS><Domain><General><Interfaces><NetworkInterface name=\"$1\"/></Interfaces></General></Domain></CycloneDDS>"
+}
+
+set_netem() {
+    local ns=$1 dev=$2 spec=$3
+    ip netns exec "$ns" tc qdisc del dev "$dev" root 2> /dev/null || true
+    if [[ -n "$spec" ]]; then
+        # shellcheck disable=SC2086  # spec is a list of netem arguments
+        ip netns exec "$ns" tc qdisc add dev "$dev" root netem $spec
+    fi
+}
+
+tx_packets() {
+    ip netns exec "$1" cat "/sys/class/net/$2/statistics/tx_packets"
+}
+
+# The server's response-writer retransmissions, from its stats endpoint. The
+# snapshot is refreshed once a second, so wait for one taken after the run.
+server_rexmit_bytes() {
+    sleep 1.5
+    curl -s --unix-socket "$STATS_SOCKET" http://localhost/ \
+        | grep -o '"response_writer":{[^}]*' | grep -o '"rexmit_bytes":[0-9]*' | cut -d: -f2 || true
+}
+
+cleanup
+ip netns add "$NS_SERVER"
+ip netns add "$NS_CLIENT"
+ip link add "$VETH_SERVER" type veth peer name "$VETH_CLIENT"
+setup_namespace "$NS_SERVER" "$VETH_SERVER" 10.77.0.1
+setup_namespace "$NS_CLIENT" "$VETH_CLIENT" 10.77.0.2
+
+mkdir -p "$OUT_DIR"
+printf "%-8s %-17s %10s %9s %9s %9s %9s %11s %11s %9s\n" \
+       netem qos goodput p50_us p99_us failed timeouts req_rexmit resp_rexmit pkts/req
+
+for netem in "${NETEM_NAMES[@]}"; do
+    set_netem "$NS_SERVER" "$VETH_SERVER" "${NETEM[$netem]}"
+    set_netem "$NS_CLIENT" "$VETH_CLIENT" "${NETEM[$netem]}"
+
+    for qos in "${QOS_NAMES[@]}"; do
+        log="$OUT_DIR/$netem-$qos"
+
+        # shellcheck disable=SC2086  # QoS options are a word list
+        ip netns exec "$NS_SERVER" env CYCLONEDDS_URI="$(cyclone_uri "$VETH_SERVER")" \
+            "$BUILD_DIR/led_server" --quiet --actuation-us 0 --stats-socket "$STATS_SOCKET" ${QOS[$qos]} \
+            > "$log.server.log" 2>&1 &
+        SERVER_PID=$!
+
+        before=$(( $(tx_packets "$NS_SERVER" "$VETH_SERVER") + $(tx_packets "$NS_CLIENT" "$VETH_CLIENT") ))
+        # shellcheck disable=SC2086
+        ip netns exec "$NS_CLIENT" env CYCLONEDDS_URI="$(cyclone_uri "$VETH_CLIENT")" \
+            "$BUILD_DIR/led_bench" --count "$COUNT" --window "$WINDOW" --warmup 100 ${QOS[$qos]} \
+            > "$log.bench.log" 2>&1 || true
+        after=$(( $(tx_packets "$NS_SERVER" "$VETH_SERVER") + $(tx_packets "$NS_CLIENT" "$VETH_CLIENT") ))
+        resp_rexmit=$(server_rexmit_bytes)
+
+        kill -INT "$SERVER_PID"
+        wait "$SERVER_PID" || true
+        SERVER_PID=
+
+        awk -v netem="$netem" -v qos="$qos" -v packets=$(( after - before )) -v resp_rexmit="${resp_rexmit:--}" '
+            function field(name, offset,    i) {
+                for (i = 1; i <= NF; i++) if ($i == name) return $(i + offset)
+                return ""
+            }
+            / latency \(/    { p50 = field("p50", 1); p99 = field("p99", 1)
+                               ok += field("ok,", -1); failed += field("failed,", -1); timeouts += field("timeouts,", -1) }
+            / throughput \(/ { goodput = field("req/s,", -1)
+                               ok += field("ok,", -1); failed += field("failed,", -1); timeouts += field("timeouts,", -1) }
+            /rexmit_bytes/   { rexmit = field("rexmit_bytes", 1) }
+            END {
+                if (goodput == "") { printf "%-8s %-17s %10s\n", netem, qos, "failed"; exit }
+                printf "%-8s %-17s %10s %9s %9s %9d %9d %11s %11s %9.2f\n", netem, qos, goodput, p50, p99,
+                       failed, timeouts, rexmit, resp_rexmit, (ok > 0 ? packets / ok : 0)
+            }' "$log.bench.log"
+    done
+done
@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+#
+# Measure led_server restart-to-first-response time, as seen in a rolling upgrade:
+# a client keeps sending while the server is repeatedly stopped and restarted.
+#
+#   scripts/restart_to_first_response.sh BUILD_DIR [RESTARTS] [RATE]
+#
+# Each restart's value is the 'total' of the server's startup report that ends in
+# the 'first response' phase (process start -> first response written).
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 BUILD_DIR [RESTARTS] [RATE]}
+RESTARTS=${2:-10}
+RATE=${3:-50}
+
+LOG=$(mktemp)
+CLIENT_PID=
+SERVER_PID=
+
+cleanup() {
+    [[ -n "$SERVER_PID" ]] && kill -INT "$SERVER_PID" 2>/dev/null || true
+    [[ -n "$CLIENT_PID" ]] && kill -INT "$CLIENT_PID" 2>/dev/null || true
+    wait 2>/dev/null || true
+    rm -f "$LOG"
+}
+trap cleanup EXIT
+
+start_server() {
+    : > "$LOG"
+    "$BUILD_DIR/led_server" --expect-clients "$1" > "$LOG" 2>&1 &
+    SERVER_PID=$!
+}
+
+stop_server() {
+    kill -INT "$SERVER_PID"
+    wait "$SERVER_PID" || true
+    SERVER_PID=
+}
+
+# Initial server, so the client can connect
+start_server 0
+"$BUILD_DIR/led_client" --rate "$RATE" > /dev/null 2>&1 &
+CLIENT_PID=$!
+sleep 2
+stop_server
+
+for run in $(seq "$RESTARTS"); do
+    start_server 1
+    for _ in $(seq 100); do
+        grep -q "first response" "$LOG" && break
+        sleep 0.1
+    done
+    grep -o "first response.*total [0-9.]* ms" "$LOG" | grep -o "total [0-9.]*" | awk -v run="$run" '{ print "restart " run ": " $2 " ms" }'
+    stop_server
+done
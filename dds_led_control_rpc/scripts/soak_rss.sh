@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+#
+# Soak test: flood led_server with requests and sample its RSS over time.
+#
+#   scripts/soak_rss.sh BUILD_DIR [DURATION_S] [RATE_PER_CLIENT] [CLIENTS] [-- LED_QOS_ARGS...]
+#
+# LED_QOS_ARGS (e.g. '--history 1 --max-instances 64') are passed to both the
+# server and the clients. Writes 'elapsed_s,rss_kb' samples to soak_rss.csv and
+# fails if RSS still grows by more than 10% over the second half of the run.
+
+set -euo pipefail
+
+BUILD_DIR=${1:?usage: $0 BUILD_DIR [DURATION_S] [RATE_PER_CLIENT] [CLIENTS] [-- LED_QOS_ARGS...]}
+DURATION=${2:-300}
+RATE=${3:-1000}
+CLIENTS=${4:-4}
+shift $(( $# < 4 ? $# : 4 ))
+[[ "${1:-}" == "--" ]] && shift
+QOS_ARGS=("$@")
+
+CSV=soak_rss.csv
+PIDS=()
+
+cleanup() {
+    kill -INT "${PIDS[@]}" 2>/dev/null || true
+    wait 2>/dev/null || true
+}
+trap cleanup EXIT
+
+"$BUILD_DIR/led_server" "${QOS_ARGS[@]}" > /dev/null &
+SERVER_PID=$!
+PIDS+=("$SERVER_PID")
+
+for _ in $(seq "$CLIENTS"); do
+    "$BUILD_DIR/led_client" --rate "$RATE" "${QOS_ARGS[@]}" > /dev/null 2>&1 &
+    PIDS+=("$!")
+done
+
+echo "elapsed_s,rss_kb" > "$CSV"
+for t in $(seq 0 "$DURATION"); do
+    rss=$(awk '/^VmRSS:/ { print $2 }' "/proc/$SERVER_PID/status")
+    echo "$t,$rss" >> "$CSV"
+    sleep 1
+done
+
+awk -F, -v half=$((DURATION / 2)) '
+    NR == 1 { next }
+    $1 == half { mid = $2 }
+    { last = $2; if ($2 > max) max = $2 }
+    END {
+        growth = (last - mid) * 100.0 / mid
+        printf "RSS at half-time: %d kB, final: %d kB, peak: %d kB, second-half growth: %.1f%%\n", mid, last, max, growth
+        exit (growth > 10.0)
+    }' "$CSV"
@@ -1,193 +1,303 @@
-#include <iostream>
 #include <chrono>
 #include <thread>
 #include <atomic>
 #include <csignal>
+#include <cstring>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
 
-/* Include the C++ DDS API. */
-#include "dds/dds.hpp"
-#include "dds/dds.h"
+#include <poll.h>
 
-#include "LedControl.hpp"
+#include "LedLog.hpp"
+#include "LedProfile.hpp"
+#include "LedServer.hpp"
+#include "LedTrace.hpp"
+#include "StatsEndpoint.hpp"
+#include "LedStartup.hpp"
 
 
 using namespace std::chrono_literals;
 
 
-class LedServer 
+
+std::atomic<bool> shutdown_flag{false};
+
+
+void signal_handler(int) 
 {
-private:
-    dds::domain::DomainParticipant participant;
-    dds::topic::Topic<led_control::LedRequest> request_topic;
-    dds::topic::Topic<led_control::LedResponse> response_topic;
-    dds::sub::Subscriber subscriber;
-    dds::pub::Publisher publisher;
-    dds::sub::DataReader<led_control::LedRequest> request_reader;
-    dds::pub::DataWriter<led_control::LedResponse> response_writer;
-    
-    std::atomic<bool> running{true};
-    
-    // Simulated LED states
-    bool led_states[3] = {false, false, false}; // RED, GREEN, BLUE
-    
-    const char* colorToString(led_control::LedColor color) 
+    shutdown_flag = true;
+}
+
+
+int main(int argc, char** argv) 
+{
+    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
+    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
+
+    // Started first thing, so the report covers the whole startup path.
+    StartupTimer startup;
+
+    const char* stats_socket = nullptr;
+    const char* ready_file = nullptr;
+    int expect_clients = 0;
+    LedServer::DispatchMode dispatch = LedServer::DispatchMode::WaitSet;
+    bool event_loop = false;    // drive the server from main's own poll() loop
+    long actuation_us = 10000;
+    bool quiet = false;
+    long ack_interval_ms = 0;
+    const char* replica = "";
+    long load_report_ms = 500;
+    long shed_after_ms = 0;
+    unsigned long panels = 1;
+    bool coroutines = false;
+    const char* trace_file = nullptr;
+    unsigned long trace_sample = 1;
+    LedQosConfig qos;
+    const char* profile = nullptr;
+
+    for (int i = 1; i < argc; ++i)
     {
-        switch(color) {
-            case led_control::LedColor::RED: return "RED";
-            case led_control::LedColor::GREEN: return "GREEN";
-            case led_control::LedColor::BLUE: return "BLUE";
-            default: return "UNKNOWN";
+        if(qos.parseArg(argc, argv, i))
+        {
+            continue;
+        }
+        else if(std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc && isCycloneProfile(argv[i + 1]))
+        {
+            profile = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--stats-socket") == 0 && i + 1 < argc)
+        {
+            stats_socket = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--ready-file") == 0 && i + 1 < argc)
+        {
+            ready_file = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--expect-clients") == 0 && i + 1 < argc)
+        {
+            expect_clients = std::atoi(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--dispatch") == 0 && i + 1 < argc &&
+                (std::strcmp(argv[i + 1], "waitset") == 0 || std::strcmp(argv[i + 1], "listener") == 0 ||
+                 std::strcmp(argv[i + 1], "eventfd") == 0))
+        {
+            ++i;
+            event_loop = std::strcmp(argv[i], "eventfd") == 0;
+            dispatch = std::strcmp(argv[i], "listener") == 0
+                ? LedServer::DispatchMode::Listener
+                : LedServer::DispatchMode::WaitSet;
+        }
+        else if(std::strcmp(argv[i], "--actuation-us") == 0 && i + 1 < argc)
+        {
+            actuation_us = std::atol(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--ack-interval-ms") == 0 && i + 1 < argc)
+        {
+            ack_interval_ms = std::atol(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--load-report-ms") == 0 && i + 1 < argc)
+        {
+            load_report_ms = std::atol(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--shed-after-ms") == 0 && i + 1 < argc)
+        {
+            shed_after_ms = std::atol(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--panels") == 0 && i + 1 < argc)
+        {
+            panels = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_file = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--trace-sample") == 0 && i + 1 < argc)
+        {
+            trace_sample = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if(std::strcmp(argv[i], "--replica") == 0 && i + 1 < argc)
+        {
+            replica = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--quiet") == 0)
+        {
+            quiet = true;
+        }
+#if LED_ENABLE_COROUTINES
+        else if(std::strcmp(argv[i], "--coroutines") == 0)
+        {
+            coroutines = true;
+        }
+#endif
+        else
+        {
+            led_log::err << "Usage: " << argv[0] << " [--stats-socket PATH] [--ready-file PATH] [--expect-clients N]"
+                      << " [--dispatch waitset|listener|eventfd] [--actuation-us N] [--ack-interval-ms N]"
+                      << " [--load-report-ms N] [--shed-after-ms N] [--panels N] [--replica NAME] [--quiet]"
+                      << " [--trace FILE [--trace-sample N]] "
+#if LED_ENABLE_COROUTINES
+                      << "[--coroutines] "
+#endif
+                      << cycloneProfileUsage() << " " << LedQosConfig::usage() << led_log::endl;
+
+            return 1;
         }
     }
-    
-    void processRequest(const led_control::LedRequest& request) 
+
+    if(coroutines && dispatch == LedServer::DispatchMode::Listener)
     {
-        std::cout << "Received request: "
-                  << colorToString(request.color()) 
-                  << " -> " << (request.state() ? "ON" : "OFF")
-                  << " (ID: " << request.request_id() << ")" << std::endl;
-        
-        // Simulate hardware control
-        int color_index = static_cast<int>(request.color());
-        led_states[color_index] = request.state();
-        
-        // Simulate some processing delay
-        std::this_thread::sleep_for(10ms);
-        
-        // Prepare response
-        led_control::LedResponse response;
-        response.success(true);
-        response.message("LED control successful");
-        response.color(request.color());
-        response.state(request.state());
-        response.request_id(request.request_id());
-        
-        // Send response
-        response_writer.write(response);
-        
-        std::cout << "Sent response for request ID: " 
-                  << request.request_id() << std::endl;
+        led_log::err << "--coroutines needs --dispatch waitset or eventfd" << led_log::endl;
+
+        return 1;
     }
-    
-    void simulateHardwareControl() 
+
+    // Actuation would run on, and block, Cyclone's delivery thread
+    if(dispatch == LedServer::DispatchMode::Listener && actuation_us > LedServer::LISTENER_BUDGET_US)
     {
-        std::cout << "\nCurrent LED States:" << std::endl;
-        std::cout << "RED: " << (led_states[0] ? "ON" : "OFF") << std::endl;
-        std::cout << "GREEN: " << (led_states[1] ? "ON" : "OFF") << std::endl;
-        std::cout << "BLUE: " << (led_states[2] ? "ON" : "OFF") << std::endl;
-    }
+        led_log::err << "--dispatch listener needs --actuation-us " << LedServer::LISTENER_BUDGET_US
+                     << " or less" << led_log::endl;
 
-public:
-    LedServer(int domain_id = 0) 
-        : participant(domain_id),
-          request_topic(participant, "led_control_requests"),
-          response_topic(participant, "led_control_responses"),
-          subscriber(participant),
-          publisher(participant),
-          request_reader(subscriber, request_topic),
-          response_writer(publisher, response_topic) {
-        
-        std::cout << "LED Control Server started" << std::endl;
-        std::cout << "Listening for requests on topic: led_control_requests" << std::endl;
-        std::cout << "Sending responses on topic: led_control_responses" << std::endl;
+        return 1;
     }
     
-    void run() 
+    if(trace_file)
     {
-        dds::sub::cond::ReadCondition read_cond(
-            request_reader,
-            dds::sub::status::DataState::any());
-        
-        dds::core::cond::WaitSet  waitset;
-        waitset += read_cond;
-        
-        while (running) 
-        {
-            try {
-                auto samples = request_reader.select()
-                    .state(dds::sub::status::DataState::new_data())
-                    .take();
-                
-                for (const auto& sample : samples) 
-                {
-                    if(sample.info().valid()) 
-                    {
-                        processRequest(sample.data());
-                    }
-                }
-                
-                // Periodically show current state
-                static auto last_display = std::chrono::steady_clock::now();
-                auto now = std::chrono::steady_clock::now();
-                if(now - last_display > 5s) {
-                    simulateHardwareControl();
-                    last_display = now;
-                }
-                
-                // Wait for next request with timeout
-                auto conditions = waitset.wait(dds::core::Duration::from_secs(1.0));
-                
-            } 
-            catch(const dds::core::Exception& e) 
-            {
-                std::cerr << "DDS Exception: " << e.what() << std::endl;
-            }
-        }
+        led_trace::Tracer::instance().enable(static_cast<uint32_t>(trace_sample));
     }
-    
-    void stop() 
+
+    if(!useProfileCycloneConfig(profile))
     {
-        running = false;
+        return 1;
     }
-};
-
-
-
-std::atomic<bool> shutdown_flag{false};
 
+    try {
+        qos.validate();
+        dds::domain::DomainParticipant participant(0); // Domain ID 0
+        startup.mark("participant");
 
-void signal_handler(int) 
-{
-    shutdown_flag = true;
-}
+        LedServer server(participant, qos, replica);
+        server.setActuationDelay(std::chrono::microseconds(actuation_us));
+        server.setDispatchMode(dispatch);
+        server.setVerbose(!quiet);
+        server.setAckInterval(std::chrono::milliseconds(ack_interval_ms));
+        server.setLoadReportInterval(std::chrono::milliseconds(load_report_ms));
+        server.setShedAfter(std::chrono::milliseconds(shed_after_ms));
+        server.setPanelCount(panels);
+#if LED_ENABLE_COROUTINES
+        server.setCoroutineHandlers(coroutines);
+#endif
+        if(ack_interval_ms > 0)
+        {
+            led_log::out << "Cumulative acks every " << ack_interval_ms
+                         << " ms on topic: led_control_acks" << led_log::endl;
+        }
+        startup.mark("entities");
 
+        // On a restart during a rolling upgrade the clients are already there:
+        // only report ready once they have (re)discovered us.
+        if(expect_clients > 0 && !server.waitForClients(expect_clients, 10s))
+        {
+            led_log::err << "Not all expected clients matched, continuing" << led_log::endl;
+        }
+        startup.mark("discovery");
+        startup.report("led_server");
+        server.setStartupTimer(&startup);
 
-int main(int argc, char** argv) 
-{
-    std::signal(SIGINT, signal_handler);    // Ctrl-C ('kill -5')
-    std::signal(SIGTERM, signal_handler);   // 'kill -7' (Ctrl-Q)
-    
-    try {
-        LedServer server(0); // Domain ID 0
+        // Optional live DDS/application statistics for monitoring
+        std::unique_ptr<StatsEndpoint> stats;
+        if(stats_socket)
+        {
+            stats = std::make_unique<StatsEndpoint>(stats_socket, [&server]() { return server.statsJson(); });
+            led_log::out << "Serving statistics on unix socket: " << stats_socket << led_log::endl;
+        }
         
-        // Run server in separate thread
-        std::thread server_thread([&server]() 
+        // Run server in separate thread - or, with an event loop, right here
+        std::thread server_thread;
+        int server_fd = -1;
+        if(event_loop)
+        {
+            server_fd = server.eventFd();
+        }
+        else
+        {
+            server_thread = std::thread([&server]()
+            {
+                server.run();
+            });
+        }
+
+        if(ready_file)
         {
-            server.run();
-        });
+            // Readiness marker for supervisors / upgrade scripts
+            std::FILE* ready = std::fopen(ready_file, "w");
+            if(ready)
+            {
+                std::fclose(ready);
+            }
+        }
+        led_log::out << "Server ready" << led_log::endl;
         
         // Wait for shutdown signal
         while(!shutdown_flag) 
         {
-            std::this_thread::sleep_for(100ms);
+            if(!event_loop)
+            {
+                std::this_thread::sleep_for(100ms);
+                continue;
+            }
+
+            // Stand-in for an application's main loop, with the server's fd among its own
+            pollfd fds{server_fd, POLLIN, 0};
+            if(::poll(&fds, 1, 100) > 0)
+            {
+                try
+                {
+                    server.pollOnce();
+                }
+                catch(const dds::core::Exception& e)
+                {
+                    led_log::err << "DDS Exception: " << e.what() << led_log::endl;
+                }
+            }
         }
         
-        std::cout << "\nShutting down server..." << std::endl;
+        led_log::out << "\nShutting down server..." << led_log::endl;
         server.stop();
-        server_thread.join();
+        if(server_thread.joinable())
+        {
+            server_thread.join();
+        }
+
+        if(trace_file)
+        {
+            if(led_trace::Tracer::instance().writeChromeJson(trace_file, "led_server"))
+            {
+                led_log::out << "Trace written to: " << trace_file << led_log::endl;
+            }
+            else
+            {
+                led_log::err << "Could not write trace file: " << trace_file << led_log::endl;
+            }
+        }
+
+        if(ready_file)
+        {
+            std::remove(ready_file);
+        }
         
-        std::cout << "Server stopped successfully" << std::endl;
+        led_log::out << "Server stopped successfully" << led_log::endl;
         
     } 
     catch(const dds::core::Exception& e) 
     {
-        std::cerr << "DDS Exception in main: " << e.what() << std::endl;
+        led_log::err << "DDS Exception in main: " << e.what() << led_log::endl;
 
         return 1;
     } 
     catch(const std::exception& e) 
     {
-        std::cerr << "Exception: " << e.what() << std::endl;
+        led_log::err << "Exception: " << e.what() << led_log::endl;
 
         return 1;
     }